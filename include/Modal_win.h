@@ -7,17 +7,20 @@
 #include <memory>
 #include "../include/physics_engine.h"
 #include "visual_config.h"
+#include "ui_resources.h"
 
 class ModalWindow {
 private:
 ////////////////////
 PhysicsEngine& engine;
+UiResources& ui;
 
 /////////////////////
     bool visible = false;
     sf::RectangleShape background;
     sf::RectangleShape dialog;
-    std::shared_ptr<sf::Font> font;
+    //тексты создаются при первом show(): к тому времени шрифт обычно уже загружен
+    bool texts_ready = false;
     
     //поля ввода
     std::string mass_input = "1.0";
@@ -52,16 +55,14 @@ PhysicsEngine& engine;
     
     //callback
     std::function<void(float, float, bool, bool, bool)> callback;
+
+    //откуда брать частицу для заполнения полей (по умолчанию - прямо из движка)
+    std::function<Particle(size_t)> particle_source;
     
 
     
 public:
-    ModalWindow(PhysicsEngine& engine): engine(engine) {
-        font = std::make_shared<sf::Font>();
-        
-        font->openFromFile("C:/Windows/Fonts/Calibri.ttf");
-        
-        
+    ModalWindow(PhysicsEngine& engine, UiResources& ui): engine(engine), ui(ui) {
         background.setFillColor(sf::Color(0, 0, 0, 150));
         dialog.setSize({(float)Config::MODAL_WIDTH, (float)Config::MODAL_HEIGHT});
         dialog.setFillColor(sf::Color(50, 50, 70));
@@ -70,6 +71,11 @@ public:
         
         setup_ui();
     }
+    //когда движок живёт на своём потоке, читать его напрямую нельзя
+    void set_particle_source(std::function<Particle(size_t)> source) {
+        particle_source = std::move(source);
+    }
+
     sf::Vector2f get_size(){
 
         return dialog.getSize();
@@ -87,36 +93,6 @@ public:
         speed_field.setOutlineColor(outline_color);
         speed_field.setOutlineThickness(1);
 
-        title = std::unique_ptr<sf::Text>(new sf::Text(*font));
-        title->setString("Pendulum Settings");
-        title->setCharacterSize(Config::TITLE_FONT_SIZE);
-        title->setFillColor(sf::Color::White);
-    
-        mass_label = std::unique_ptr<sf::Text>(new sf::Text(*font));
-        mass_label->setString("Mass:");
-        mass_label->setCharacterSize(Config::LABEL_FONT_SIZE);
-        mass_label->setFillColor(sf::Color::White);
-        
-        speed_label = std::unique_ptr<sf::Text>(new sf::Text(*font));
-        speed_label->setString("Velocity:");
-        speed_label->setCharacterSize(Config::LABEL_FONT_SIZE);
-        speed_label->setFillColor(sf::Color::White);
-
-        direction_text = std::unique_ptr<sf::Text>(new sf::Text(*font));
-        direction_text->setString("Direction: Right");
-        direction_text->setCharacterSize(Config::LABEL_FONT_SIZE);
-        direction_text->setFillColor(sf::Color::White);
-        
-        mass_value_text = std::unique_ptr<sf::Text>(new sf::Text(*font));
-        mass_value_text->setString(mass_input);
-        mass_value_text->setCharacterSize(Config::VALUE_FONT_SIZE);
-        mass_value_text->setFillColor(sf::Color::White);
-        
-        speed_value_text = std::unique_ptr<sf::Text>(new sf::Text(*font));
-        speed_value_text->setString(speed_input);
-        speed_value_text->setCharacterSize(Config::VALUE_FONT_SIZE);
-        speed_value_text->setFillColor(sf::Color::White);
-        
         //кнопки
         ok_btn.setSize({(float)Config::BUTTON_WIDTH, (float)Config::BUTTON_HEIGHT});
         ok_btn.setFillColor(sf::Color(60, 140, 60));
@@ -133,32 +109,33 @@ public:
         delete_btn.setOutlineColor(sf::Color::White);
         delete_btn.setOutlineThickness(1);
         
-        ok_text = std::unique_ptr<sf::Text>(new sf::Text(*font));
-        ok_text->setString("OK");
-        ok_text->setCharacterSize(Config::BUTTON_FONT_SIZE);
-        ok_text->setFillColor(sf::Color::White);
-        
-        cancel_text = std::unique_ptr<sf::Text>(new sf::Text(*font));
-        cancel_text->setString("Cancel");
-        cancel_text->setCharacterSize(Config::BUTTON_FONT_SIZE);
-        cancel_text->setFillColor(sf::Color::White);
-        
-        delete_text = std::unique_ptr<sf::Text>(new sf::Text(*font));
-        delete_text->setString("Remove");
-        delete_text->setCharacterSize(Config::BUTTON_FONT_SIZE);
-        delete_text->setFillColor(sf::Color::White);
+    }
+
+    void setup_texts() {
+        title = ui.makeText("Pendulum Settings", Config::TITLE_FONT_SIZE);
+        mass_label = ui.makeText("Mass:", Config::LABEL_FONT_SIZE);
+        speed_label = ui.makeText("Velocity:", Config::LABEL_FONT_SIZE);
+        direction_text = ui.makeText("Direction: Right", Config::LABEL_FONT_SIZE);
+        mass_value_text = ui.makeText(mass_input, Config::VALUE_FONT_SIZE);
+        speed_value_text = ui.makeText(speed_input, Config::VALUE_FONT_SIZE);
+
+        ok_text = ui.makeText("OK", Config::BUTTON_FONT_SIZE);
+        cancel_text = ui.makeText("Cancel", Config::BUTTON_FONT_SIZE);
+        delete_text = ui.makeText("Remove", Config::BUTTON_FONT_SIZE);
+        texts_ready = true;
     }
     
     void show( bool isCreate, size_t index, const sf::Vector2f& pos, 
               std::function<void(float, float, bool, bool, bool)> cb) {
         
+        if (!texts_ready) setup_texts();
         visible = true;
         callback = cb;
         
         if(!isCreate){
 
            std::cerr<< "i m here " << index<<" ";
-           Particle p = engine.getParticle(index);
+           Particle p = particle_source ? particle_source(index) : engine.getParticle(index);
            direction_right = false;
            
 
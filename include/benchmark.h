@@ -0,0 +1,45 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include "headless.h"
+
+//настройки движка, которые перебирает замер
+struct BenchConfig {
+    SolverMode solver = SolverMode::GaussSeidel;
+    double dt = 0.016;
+    int iterations = 10;
+    double damping = 0.0;
+};
+
+//одна строка таблицы: ошибка против аналитического ответа и цена
+//(секунды реального времени на секунду симуляции)
+struct BenchResult {
+    std::string scenario;
+    std::string metric;
+    BenchConfig config;
+    double error = 0.0;
+    double wall_per_sim_second = 0.0;
+    bool pareto = false;
+};
+
+//задачи с известным ответом:
+//  period   - период малых колебаний маятника против 2pi*sqrt(L/g)
+//  energy   - дрейф энергии двойного маятника без трения, доля mgL в секунду
+//  stretch  - наибольшее растяжение звена цепи под тяжестью, доля длины
+std::vector<BenchResult> run_benchmarks(const std::vector<std::string>& scenarios,
+                                        const std::vector<BenchConfig>& configs, double sim_time,
+                                        unsigned threads);
+
+//отметить строки, которые не хуже любой другой той же задачи сразу по ошибке и по цене
+void mark_pareto(std::vector<BenchResult>& results);
+
+bool write_bench_csv(const std::string& path, const std::vector<BenchResult>& results);
+bool write_bench_json(const std::string& path, const std::vector<BenchResult>& results);
+
+//--bench [задачи...] --dt-list ... --iter-list ... --damping-list ... --solver-list gs jacobi cg
+//        --sim-time s --csv file --json file --budget err
+int bench_mode(const CliArgs& args);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef CG_SOLVER_H
+#define CG_SOLVER_H
+
+#include <cstddef>
+#include <vector>
+
+struct Particle;
+struct Constraint;
+class TaskScheduler;
+
+//глобальный решатель связей расстояния: на каждой итерации все связи линеаризуются
+//разом и система (J W J^T + alpha) dlambda = -C решается сопряжёнными градиентами
+//с диагональным предобуславливателем. Матрица не хранится: A p = J (W (J^T p)),
+//оба множителя - проходы по столбцам связей и по спискам связей частиц
+class CGSolver {
+public:
+    void build(const std::vector<Particle>& particles, const std::vector<Constraint>& constraints);
+
+    //одна линеаризация и до max_iterations шагов CG (останов по относительной невязке
+    //tolerance); warm_start - начать с множителей прошлого шага.
+    //Результат не зависит от числа потоков: суммы собираются кусками фиксированного размера
+    int iterate(std::vector<Particle>& particles, int max_iterations, double tolerance, bool warm_start,
+                TaskScheduler* scheduler);
+
+    size_t constraintCount() const { return rest.size(); }
+    //множители для тёплого старта следующего шага (их хранят снимки перемотки);
+    //чужого размера - сбрасываются
+    const std::vector<double>& warmStart() const { return warm; }
+    void setWarmStart(const std::vector<double>& w) {
+        if (w.size() == rest.size()) warm = w;
+        else warm.clear();
+    }
+
+    //шагов CG на последней линеаризации
+    int lastIterations() const { return last_iterations; }
+
+private:
+    static constexpr size_t CHUNK = 4096;
+
+    template <class Fn>
+    void forChunks(TaskScheduler* scheduler, size_t n, Fn&& fn) const;
+    double dotChunks(TaskScheduler* scheduler, const std::vector<double>& a, const std::vector<double>& b);
+    //u = W J^T v по частицам
+    void spread(TaskScheduler* scheduler, const std::vector<double>& v);
+    //out = (J W J^T + alpha) v
+    void apply(TaskScheduler* scheduler, const std::vector<double>& v, std::vector<double>& out);
+
+    //связь k: частицы i1[k], i2[k], длина rest[k]; floor[k] = 0 у верёвок;
+    //alpha[k] - податливость, дающая одиночной связи поправку stiffness * C
+    std::vector<size_t> i1, i2;
+    std::vector<double> rest, floor, alpha, diag_w;
+
+    //линеаризация: нормаль связи, невязка, маска активных (сжатая верёвка не тянет)
+    std::vector<double> nx, ny, active;
+
+    //связи частицы p: incident[incident_start[p] .. incident_start[p + 1]),
+    //incident_s - знак (-1 у первой частицы связи, +1 у второй)
+    std::vector<size_t> incident_start;
+    std::vector<size_t> incident;
+    std::vector<double> incident_s;
+    std::vector<double> inv_mass;
+
+    //векторы CG и смещения частиц
+    std::vector<double> lambda, r, z, p, ap, warm;
+    std::vector<double> ux, uy;
+    std::vector<double> partial;
+    int last_iterations = 0;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef COLLIDERS_H
+#define COLLIDERS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "Vec2D.h"
+
+struct Particle;
+class TaskScheduler;
+
+//неподвижная геометрия сцены (пол, стены, препятствия) в дереве ограничивающих
+//прямоугольников (BVH); частицы не проходят внутрь, в том числе за один шаг
+class StaticColliders {
+public:
+    //отрезок толщиной 2 * radius (radius = 0 - тонкая стенка)
+    void addSegment(const Vec2d& a, const Vec2d& b, double radius = 0.0);
+    void addCircle(const Vec2d& center, double radius);
+    //прямоугольник с центром center и полуразмерами half, повёрнутый на angle
+    void addBox(const Vec2d& center, const Vec2d& half, double angle = 0.0);
+    //ломаная из points.size() - 1 отрезков (замкнутая - на один больше)
+    void addPolyline(const std::vector<Vec2d>& points, bool closed = false, double radius = 0.0);
+    //ёмкость растёт хотя бы вдвое, чтобы добавление ломаных по одной не было квадратичным
+    void reserve(size_t primitives) {
+        size_t need = prims.size() + primitives;
+        if (need > prims.capacity()) prims.reserve(std::max(need, 2 * prims.capacity()));
+    }
+    void clear();
+
+    bool empty() const { return prims.empty(); }
+    size_t size() const { return prims.size(); }
+    //растёт при любом изменении набора (для перерисовки)
+    size_t version() const { return changes; }
+
+    enum class Kind { Segment, Circle };
+    struct Primitive {
+        Kind kind;
+        Vec2d a, b;     //концы отрезка; у круга a - центр
+        double radius;
+    };
+    const Primitive& primitive(size_t i) const { return prims[i]; }
+
+    //контакты шага: для каждой подвижной частицы (не закреплена, inv_mass > 0) - примитивы,
+    //которых касается её путь position -> predicted_position (расширенный на particle_radius)
+    void findContacts(const std::vector<Particle>& particles, double particle_radius,
+                      TaskScheduler* scheduler);
+    //вытолкнуть частицы из найденных примитивов (одна итерация, в цикле решателя)
+    void resolveContacts(std::vector<Particle>& particles, double particle_radius,
+                         TaskScheduler* scheduler) const;
+    size_t contactCount() const { return contact_prims.size(); }
+
+    size_t nodeCount() const { return nodes.size(); }
+
+private:
+    struct Box {
+        double min_x, min_y, max_x, max_y;
+    };
+    struct Node {
+        Box box;
+        int left, right;        //-1 у листа
+        size_t first, count;    //лист: отрезок в order
+    };
+
+    static constexpr size_t LEAF_SIZE = 4;
+
+    Box bounds(const Primitive& p) const;
+    void add(const Primitive& p);
+    void rebuild();
+    int build(size_t first, size_t count);
+    template <class Fn>
+    void query(const Box& box, Fn&& fn) const;
+
+    std::vector<Primitive> prims;
+    std::vector<Box> prim_boxes;
+    size_t changes = 0;
+    bool dirty = true;
+
+    std::vector<Node> nodes;
+    std::vector<size_t> order;
+
+    //контакты в виде CSR: частица contact_particles[k] касается
+    //contact_prims[contact_start[k] .. contact_start[k + 1])
+    std::vector<size_t> contact_particles;
+    std::vector<size_t> contact_start;
+    std::vector<size_t> contact_prims;
+};
+
+#endif
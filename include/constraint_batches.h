@@ -0,0 +1,108 @@
+#ifndef CONSTRAINT_BATCHES_H
+#define CONSTRAINT_BATCHES_H
+
+#include <cstddef>
+#include <vector>
+#include "constraint_kernels.h"
+
+struct Particle;
+struct Constraint;
+struct AngleConstraint;
+
+//связи, разложенные по видам: у каждого вида свой цикл без ветвлений,
+//веса (inv_mass / сумма * жёсткость) посчитаны заранее;
+//внутри вида связи сгруппированы по островам, порядок внутри острова сохранён
+class ConstraintBatches {
+public:
+    //обе частицы подвижны: стержни и пружины (жёсткость уже в весах) и верёвки
+    struct PairItem {
+        size_t i1, i2;
+        double length;
+        double w1, w2;
+    };
+    //одна частица закреплена: двигается только free_idx
+    struct PinnedItem {
+        size_t free_idx, pivot_idx;
+        double length;
+        double w;
+    };
+    struct AngleItem {
+        size_t a, center, b;
+        double min_angle, max_angle;
+        double wa, wb;
+    };
+
+    void build(const std::vector<Particle>& particles, const std::vector<Constraint>& constraints,
+               const std::vector<AngleConstraint>& angles);
+
+    size_t islandCount() const { return island_count; }
+
+    //iterations проходов по всем видам связей острова
+    void solveIsland(size_t island, std::vector<Particle>& particles, int iterations) const;
+    //один проход по всем ограничениям углов (для решателя Якоби, который их не знает)
+    void solveAngles(std::vector<Particle>& particles) const;
+
+    //то же над любыми позициями: pos(i) -> V& (например, дуальные для касательных)
+    template <class Pos>
+    void solveIslandAt(size_t island, Pos&& pos, int iterations) const;
+    template <class Pos>
+    void solveAnglesAt(Pos&& pos) const;
+
+    size_t linkCount() const { return links.size(); }
+    size_t pinnedCount() const { return pinned.size(); }
+    size_t ropeCount() const { return ropes.size(); }
+    size_t angleCount() const { return angle_items.size(); }
+
+private:
+    template <class Item>
+    struct Batch {
+        std::vector<Item> items;
+        std::vector<size_t> offsets;    //отрезок острова k: [offsets[k], offsets[k + 1])
+        size_t size() const { return items.size(); }
+    };
+
+    //стержни и пружины различаются только весами - один вид; в острове сначала стержни
+    Batch<PairItem> links;
+    Batch<PinnedItem> pinned;
+    Batch<PairItem> ropes;
+    Batch<AngleItem> angle_items;
+    size_t island_count = 0;
+};
+
+template <class Pos>
+void ConstraintBatches::solveIslandAt(size_t island, Pos&& pos, int iterations) const {
+    const PairItem* link_b = links.items.data() + links.offsets[island];
+    const PairItem* link_e = links.items.data() + links.offsets[island + 1];
+    const PinnedItem* pin_b = pinned.items.data() + pinned.offsets[island];
+    const PinnedItem* pin_e = pinned.items.data() + pinned.offsets[island + 1];
+    const PairItem* rope_b = ropes.items.data() + ropes.offsets[island];
+    const PairItem* rope_e = ropes.items.data() + ropes.offsets[island + 1];
+    const AngleItem* angle_b = angle_items.items.data() + angle_items.offsets[island];
+    const AngleItem* angle_e = angle_items.items.data() + angle_items.offsets[island + 1];
+
+    //жёсткость стержней и пружин уже внутри w1/w2
+    for (int iter = 0; iter < iterations; iter++) {
+        for (const PinnedItem* it = pin_b; it != pin_e; ++it) {
+            kernels::project_pinned(pos(it->free_idx), pos(it->pivot_idx), it->length, it->w);
+        }
+        for (const PairItem* it = link_b; it != link_e; ++it) {
+            kernels::project_pair(pos(it->i1), pos(it->i2), it->length, it->w1, it->w2, false);
+        }
+        for (const PairItem* it = rope_b; it != rope_e; ++it) {
+            kernels::project_pair(pos(it->i1), pos(it->i2), it->length, it->w1, it->w2, true);
+        }
+        for (const AngleItem* it = angle_b; it != angle_e; ++it) {
+            kernels::project_angle(pos(it->a), pos(it->center), pos(it->b), it->min_angle, it->max_angle,
+                                   it->wa, it->wb);
+        }
+    }
+}
+
+template <class Pos>
+void ConstraintBatches::solveAnglesAt(Pos&& pos) const {
+    for (const AngleItem& it : angle_items.items) {
+        kernels::project_angle(pos(it.a), pos(it.center), pos(it.b), it.min_angle, it.max_angle, it.wa, it.wb);
+    }
+}
+
+#endif
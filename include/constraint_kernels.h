@@ -0,0 +1,62 @@
+#ifndef CONSTRAINT_KERNELS_H
+#define CONSTRAINT_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+
+//проекции связей, общие для обычного шага (Vec2d) и шага с касательными (DualVec2<K>):
+//V - двумерный вектор, скаляр берётся из dot(V, V); pos(i) возвращает V& частицы i.
+//Порядок операций над значениями у обеих версий один и тот же
+namespace kernels {
+
+//два конца тянутся к длине length; rope - только растянутая связь
+template <class V>
+inline void project_pair(V& x1, V& x2, double length, double w1, double w2, bool rope) {
+    using std::sqrt;
+    V delta = x2 - x1;
+    auto len = sqrt(dot(delta, delta));
+    if (!(len > 1e-9)) return;
+    auto stretch = len - length;
+    if (rope && !(stretch > 0.0)) return;
+    auto k = stretch / len;
+    x1 += delta * (k * w1);
+    x2 -= delta * (k * w2);
+}
+
+//связь с закреплённой опорой: поправка целиком достаётся свободной частице
+template <class V>
+inline void project_pinned(V& x, const V& pivot, double length, double w) {
+    using std::sqrt;
+    V delta = x - pivot;
+    auto len = sqrt(dot(delta, delta));
+    if (!(len > 1e-9)) return;
+    auto k = (len - length) / len;
+    x -= delta * (k * w);
+}
+
+//ограничение угла a-center-b: плечи поворачиваются вокруг center, длины не меняются
+template <class V>
+inline void project_angle(V& xa, const V& c, V& xb, double min_angle, double max_angle, double wa, double wb) {
+    using std::atan2;
+    V u = xa - c;
+    V v = xb - c;
+
+    auto angle = atan2(u.x * v.y - u.y * v.x, dot(u, v));
+    double sign = angle < 0.0 ? -1.0 : 1.0;
+    auto current = angle * sign;
+    decltype(current) fix;
+    if (current < min_angle) {
+        fix = min_angle - current;
+    } else if (current > max_angle) {
+        fix = max_angle - current;
+    } else {
+        return;
+    }
+
+    xa = c + rotate(fix * (-sign * wa), u);
+    xb = c + rotate(fix * (sign * wb), v);
+}
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Vec2D.h"
+
+struct Particle;
+struct Constraint;
+class TaskScheduler;
+
+//одна выборка диагностики после шага
+struct DiagnosticsSample {
+    std::uint64_t step = 0;
+    double time = 0.0;
+
+    //энергия по gravity и inv_mass; потенциальная отсчитывается от начала координат
+    double kinetic = 0.0;
+    double potential = 0.0;
+    double total = 0.0;
+    //(E - E0) / масштаб энергии сцены при опорной выборке (см. Diagnostics)
+    double energy_drift = 0.0;
+
+    Vec2d momentum{0.0, 0.0};
+
+    //относительное растяжение связей |len - L| / L (у верёвки - только растяжение)
+    double max_stretch = 0.0;
+    double rms_stretch = 0.0;
+};
+
+enum class DiagnosticMetric { EnergyDrift, Momentum, MaxStretch, RmsStretch };
+
+//значение метрики в выборке (для EnergyDrift и Momentum - по модулю)
+double metricValue(const DiagnosticsSample& s, DiagnosticMetric metric);
+const char* metricName(DiagnosticMetric metric);
+
+//диагностика после шага 4: энергии, импульс и растяжение связей одним проходом по
+//частицам и одним по связям. Суммы - по кускам фиксированного размера и затем по
+//порядку кусков, так что от числа потоков не зависят. Последние выборки лежат в
+//кольце фиксированного размера; пороги вызывают обработчик при выходе метрики за
+//границу (один раз, пока она не вернётся), NaN считается выходом за любую границу
+class Diagnostics {
+public:
+    using ThresholdCallback = std::function<void(const DiagnosticsSample&, DiagnosticMetric, double)>;
+
+    //history выборок, выборка каждые interval шагов; history = 0 выключает
+    void configure(size_t history, size_t interval);
+    bool enabled() const { return !ring.empty(); }
+    size_t interval() const { return every; }
+
+    //вызывается движком после шага
+    void sample(const std::vector<Particle>& particles, const std::vector<Constraint>& constraints,
+                const Vec2d& gravity, double time, std::uint64_t step, size_t topology_version,
+                TaskScheduler* scheduler);
+
+    //история от старой выборки к новой
+    size_t size() const { return count; }
+    const DiagnosticsSample& at(size_t k) const { return ring[(head + k) % ring.size()]; }
+    const DiagnosticsSample& latest() const { return at(count - 1); }
+    std::vector<DiagnosticsSample> history() const;
+
+    //опорная выборка для дрейфа энергии; новая берётся после смены топологии
+    //и перемотки назад, а также по rebase()
+    void rebase() { have_reference = false; }
+    double energyScale() const { return energy_scale; }
+
+    size_t addThreshold(DiagnosticMetric metric, double bound, ThresholdCallback callback);
+    void clearThresholds() { thresholds.clear(); }
+    //хоть один порог сработал с последнего configure/resetTripped
+    bool tripped() const { return any_tripped; }
+    void resetTripped();
+
+private:
+    struct Threshold {
+        DiagnosticMetric metric;
+        double bound;
+        ThresholdCallback callback;
+        bool over = false;
+    };
+
+    //частичные суммы одного куска
+    struct ParticlePart {
+        double kinetic, potential, px, py, mass;
+        Vec2d lo, hi;
+    };
+    struct ConstraintPart {
+        double max_stretch, sum_sq;
+    };
+
+    std::vector<DiagnosticsSample> ring;
+    size_t head = 0;
+    size_t count = 0;
+    size_t every = 1;
+
+    bool have_reference = false;
+    size_t reference_version = size_t(-1);
+    std::uint64_t last_step = 0;
+    double reference_energy = 0.0;
+    double energy_scale = 1.0;
+
+    std::vector<Threshold> thresholds;
+    bool any_tripped = false;
+
+    std::vector<ParticlePart> particle_parts;
+    std::vector<ConstraintPart> constraint_parts;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef DUAL_H
+#define DUAL_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+//дуальное число с K касательными: значение v и производные d[k] по K направлениям сразу.
+//Арифметика над v та же, что у double, так что значение совпадает с обычным расчётом
+template <size_t K>
+struct Dual {
+    double v = 0.0;
+    std::array<double, K> d{};
+
+    Dual() = default;
+    Dual(double value) : v(value) {}
+
+    Dual operator-() const {
+        Dual r;
+        r.v = -v;
+        for (size_t k = 0; k < K; k++) r.d[k] = -d[k];
+        return r;
+    }
+    Dual& operator+=(const Dual& o) {
+        v += o.v;
+        for (size_t k = 0; k < K; k++) d[k] += o.d[k];
+        return *this;
+    }
+    Dual& operator-=(const Dual& o) {
+        v -= o.v;
+        for (size_t k = 0; k < K; k++) d[k] -= o.d[k];
+        return *this;
+    }
+    Dual& operator*=(const Dual& o) {
+        for (size_t k = 0; k < K; k++) d[k] = d[k] * o.v + v * o.d[k];
+        v *= o.v;
+        return *this;
+    }
+    Dual& operator/=(const Dual& o) {
+        double inv = 1.0 / o.v;
+        v /= o.v;
+        for (size_t k = 0; k < K; k++) d[k] = (d[k] - v * o.d[k]) * inv;
+        return *this;
+    }
+    Dual& operator*=(double s) {
+        v *= s;
+        for (size_t k = 0; k < K; k++) d[k] *= s;
+        return *this;
+    }
+    Dual& operator/=(double s) {
+        v /= s;
+        for (size_t k = 0; k < K; k++) d[k] /= s;
+        return *this;
+    }
+};
+
+template <size_t K> inline Dual<K> operator+(Dual<K> a, const Dual<K>& b) { return a += b; }
+template <size_t K> inline Dual<K> operator-(Dual<K> a, const Dual<K>& b) { return a -= b; }
+template <size_t K> inline Dual<K> operator*(Dual<K> a, const Dual<K>& b) { return a *= b; }
+template <size_t K> inline Dual<K> operator/(Dual<K> a, const Dual<K>& b) { return a /= b; }
+template <size_t K> inline Dual<K> operator+(Dual<K> a, double b) { a.v += b; return a; }
+template <size_t K> inline Dual<K> operator-(Dual<K> a, double b) { a.v -= b; return a; }
+template <size_t K> inline Dual<K> operator-(double a, const Dual<K>& b) { return -b + a; }
+template <size_t K> inline Dual<K> operator*(Dual<K> a, double b) { return a *= b; }
+template <size_t K> inline Dual<K> operator*(double a, Dual<K> b) { return b *= a; }
+template <size_t K> inline Dual<K> operator/(Dual<K> a, double b) { return a /= b; }
+
+//сравнения - только по значению (ветвления решаются так же, как в обычном шаге)
+template <size_t K> inline bool operator<(const Dual<K>& a, double b) { return a.v < b; }
+template <size_t K> inline bool operator>(const Dual<K>& a, double b) { return a.v > b; }
+template <size_t K> inline bool operator<(const Dual<K>& a, const Dual<K>& b) { return a.v < b.v; }
+template <size_t K> inline bool operator>(const Dual<K>& a, const Dual<K>& b) { return a.v > b.v; }
+
+template <size_t K>
+inline Dual<K> sqrt(const Dual<K>& a) {
+    Dual<K> r;
+    r.v = std::sqrt(a.v);
+    double g = r.v > 0.0 ? 0.5 / r.v : 0.0;
+    for (size_t k = 0; k < K; k++) r.d[k] = a.d[k] * g;
+    return r;
+}
+
+template <size_t K>
+inline Dual<K> sin(const Dual<K>& a) {
+    Dual<K> r;
+    r.v = std::sin(a.v);
+    double g = std::cos(a.v);
+    for (size_t k = 0; k < K; k++) r.d[k] = a.d[k] * g;
+    return r;
+}
+
+template <size_t K>
+inline Dual<K> cos(const Dual<K>& a) {
+    Dual<K> r;
+    r.v = std::cos(a.v);
+    double g = -std::sin(a.v);
+    for (size_t k = 0; k < K; k++) r.d[k] = a.d[k] * g;
+    return r;
+}
+
+template <size_t K>
+inline Dual<K> atan2(const Dual<K>& y, const Dual<K>& x) {
+    Dual<K> r;
+    r.v = std::atan2(y.v, x.v);
+    double q = x.v * x.v + y.v * y.v;
+    double gy = q > 0.0 ? x.v / q : 0.0;
+    double gx = q > 0.0 ? -y.v / q : 0.0;
+    for (size_t k = 0; k < K; k++) r.d[k] = y.d[k] * gy + x.d[k] * gx;
+    return r;
+}
+
+//двумерный вектор из дуальных чисел - то же, что Vec2d, для шага с касательными
+template <size_t K>
+struct DualVec2 {
+    Dual<K> x, y;
+
+    DualVec2& operator+=(const DualVec2& o) { x += o.x; y += o.y; return *this; }
+    DualVec2& operator-=(const DualVec2& o) { x -= o.x; y -= o.y; return *this; }
+};
+
+template <size_t K> inline DualVec2<K> operator+(DualVec2<K> a, const DualVec2<K>& b) { return a += b; }
+template <size_t K> inline DualVec2<K> operator-(DualVec2<K> a, const DualVec2<K>& b) { return a -= b; }
+template <size_t K> inline DualVec2<K> operator*(const DualVec2<K>& a, const Dual<K>& s) { return {a.x * s, a.y * s}; }
+template <size_t K> inline DualVec2<K> operator*(const DualVec2<K>& a, double s) { return {a.x * s, a.y * s}; }
+template <size_t K> inline DualVec2<K> operator/(const DualVec2<K>& a, double s) { return {a.x / s, a.y / s}; }
+
+template <size_t K>
+inline Dual<K> dot(const DualVec2<K>& a, const DualVec2<K>& b) {
+    return a.x * b.x + a.y * b.y;
+}
+
+template <size_t K>
+inline DualVec2<K> rotate(const Dual<K>& angle, const DualVec2<K>& v) {
+    Dual<K> cosa = cos(angle);
+    Dual<K> sina = sin(angle);
+    return {v.x * cosa - v.y * sina, v.x * sina + v.y * cosa};
+}
+
+#endif
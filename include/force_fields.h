@@ -0,0 +1,170 @@
+#ifndef FORCE_FIELDS_H
+#define FORCE_FIELDS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Vec2D.h"
+
+struct Particle;
+class TaskScheduler;
+
+//то, что движок передаёт полям на каждом шаге
+struct FieldContext {
+    TaskScheduler* scheduler = nullptr;
+    size_t grain = 2048;
+    double time = 0.0;
+
+    //fn(b, e) по кускам [0, n), параллельно если есть пул
+    void forRange(size_t n, const std::function<void(size_t, size_t)>& fn) const;
+};
+
+//поле сил: добавляет свою силу в forces[i] для каждой частицы;
+//движок переводит силы в скорости перед предсказанием позиций
+class ForceField {
+public:
+    ForceField() { touch(); }
+    virtual ~ForceField() = default;
+    virtual void accumulate(const std::vector<Particle>& particles, std::vector<Vec2d>& forces,
+                            const FieldContext& ctx) = 0;
+    //движок перенумеровал частицы: new_of_old[старый индекс] = новый, частиц теперь new_count;
+    //у удалённых частиц в new_of_old стоит NO_PARTICLE - их данные поле должно забыть
+    virtual void remapParticles(const std::vector<size_t>& new_of_old, size_t new_count) {
+        (void)new_of_old;
+        (void)new_count;
+    }
+
+    //номер последнего изменения параметров; номера общие для всех полей и только растут,
+    //так что движок замечает правку любого своего поля (и не даёт перемотать через неё)
+    std::uint64_t revision() const { return changed_at; }
+
+protected:
+    //вызывается каждым сеттером
+    void touch();
+
+private:
+    std::uint64_t changed_at = 0;
+};
+
+//однородное поле ускорения (как gravity, но отключаемое)
+class UniformField : public ForceField {
+public:
+    explicit UniformField(const Vec2d& accel) : acceleration(accel) {}
+    void accumulate(const std::vector<Particle>& particles, std::vector<Vec2d>& forces,
+                    const FieldContext& ctx) override;
+
+    const Vec2d& getAcceleration() const { return acceleration; }
+    void setAcceleration(const Vec2d& accel) { acceleration = accel; touch(); }
+
+private:
+    Vec2d acceleration;
+};
+
+//притяжение к точке: ускорение strength / (r^2 + softening^2), strength < 0 - отталкивание
+class PointAttractor : public ForceField {
+public:
+    PointAttractor(const Vec2d& c, double s, double soft = 10.0) : center(c), strength(s), softening(soft) {}
+    void accumulate(const std::vector<Particle>& particles, std::vector<Vec2d>& forces,
+                    const FieldContext& ctx) override;
+
+    const Vec2d& getCenter() const { return center; }
+    double getStrength() const { return strength; }
+    void setCenter(const Vec2d& c) { center = c; touch(); }
+    void setStrength(double s) { strength = s; touch(); }
+    void setSoftening(double soft) { softening = soft; touch(); }
+
+private:
+    Vec2d center;
+    double strength;
+    double softening;
+};
+
+//сопротивление среды: F = -(linear + quadratic * |v|) * v
+class DragField : public ForceField {
+public:
+    explicit DragField(double lin, double quad = 0.0) : linear(lin), quadratic(quad) {}
+    void accumulate(const std::vector<Particle>& particles, std::vector<Vec2d>& forces,
+                    const FieldContext& ctx) override;
+
+    void setCoefficients(double lin, double quad) { linear = lin; quadratic = quad; touch(); }
+
+private:
+    double linear;
+    double quadratic;
+};
+
+//пружины Гука: частица-точка и частица-частица
+class SpringField : public ForceField {
+public:
+    void addAnchor(size_t idx, const Vec2d& anchor, double k, double rest = 0.0) {
+        anchors.push_back({idx, anchor, k, rest});
+        touch();
+    }
+    void addSpring(size_t idx1, size_t idx2, double k, double rest) {
+        springs.push_back({idx1, idx2, k, rest});
+        touch();
+    }
+    void accumulate(const std::vector<Particle>& particles, std::vector<Vec2d>& forces,
+                    const FieldContext& ctx) override;
+    void remapParticles(const std::vector<size_t>& new_of_old, size_t new_count) override;
+
+private:
+    struct Anchor { size_t idx; Vec2d point; double k; double rest; };
+    struct Spring { size_t idx1; size_t idx2; double k; double rest; };
+    std::vector<Anchor> anchors;
+    std::vector<Spring> springs;
+};
+
+//попарное взаимодействие всех частиц через дерево Барнса-Хата, O(N log N)
+class PairwiseField : public ForceField {
+public:
+    enum class Kind { Gravity, Electrostatic };
+
+    //gravity: притяжение с константой coupling по массам;
+    //electrostatic: кулоновское взаимодействие по зарядам (одноимённые отталкиваются)
+    PairwiseField(Kind k, double coupling, double softening = 5.0, double theta = 0.5)
+        : kind(k), coupling(coupling), softening(softening), theta(theta) {}
+
+    void setTheta(double t) { theta = t < 0.0 ? 0.0 : t; touch(); }
+    void setSoftening(double s) { softening = s; touch(); }
+    //заряды частиц для Electrostatic (у кого нет заряда - 1)
+    void setCharges(std::vector<double> q) { charges = std::move(q); touch(); }
+    const std::vector<double>& getCharges() const { return charges; }
+
+    void accumulate(const std::vector<Particle>& particles, std::vector<Vec2d>& forces,
+                    const FieldContext& ctx) override;
+    void remapParticles(const std::vector<size_t>& new_of_old, size_t new_count) override;
+
+    size_t nodeCount() const { return nodes.size(); }
+
+private:
+    struct Node {
+        double min_x, min_y, size;
+        double cx, cy;          //центр источника
+        double strength;        //сумма масс или зарядов
+        double weight;          //сумма модулей - вес при усреднении центра
+        int child[4];
+        size_t first, count;    //для листа - отрезок в leaf_x/leaf_y/leaf_s
+    };
+
+    static constexpr size_t LEAF_SIZE = 16;
+
+    double sourceStrength(const Particle& p, size_t idx) const;
+    int build(size_t first, size_t count, double min_x, double min_y, double size, int depth);
+    Vec2d evaluate(double x, double y) const;
+
+    Kind kind;
+    double coupling;
+    double softening;
+    double theta;
+    std::vector<double> charges;
+
+    //дерево и листья в виде плотных массивов (SoA) для векторных циклов
+    std::vector<Node> nodes;
+    std::vector<size_t> order;
+    std::vector<double> leaf_x, leaf_y, leaf_s;
+    std::vector<double> src_x, src_y, src_s;
+};
+
+#endif
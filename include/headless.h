@@ -0,0 +1,42 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <string>
+#include <vector>
+#include "physics_engine.h"
+
+//разбор аргументов вида --key value1 value2 --flag
+class CliArgs {
+public:
+    CliArgs(int argc, char* argv[]);
+
+    bool has(const std::string& key) const;
+    //все значения после ключа до следующего --ключа
+    std::vector<std::string> values(const std::string& key) const;
+    std::string get(const std::string& key, const std::string& def = "") const;
+    double getDouble(const std::string& key, double def) const;
+    long long getInt(const std::string& key, long long def) const;
+
+private:
+    std::vector<std::string> args;
+};
+
+//стандартные сцены для режимов без окна: chain, rope, cloth, tree, array, double
+SceneRange build_scene(PhysicsEngine& engine, const std::string& name, size_t size);
+
+//режимы без окна; true - режим найден и выполнен, код возврата в exit_code
+//  --trace <file>        записать хэши состояния каждые --hash-every шагов
+//                        (с --frame-budget ms - кадрами под QualityController)
+//  --compare <a> <b>     найти первый шаг, на котором два следа расходятся
+//  --determinism-check   сравнить прогон в 1 поток и в --threads потоков
+//  --bench [задачи]      точность против цены на задачах с известным ответом (benchmark.h)
+//  --lyapunov            два старших показателя Ляпунова сцены (--scene, по умолчанию double)
+//                        шагом с касательными (tangent_stepper.h)
+//  --monitor             прогон сцены с диагностикой (diagnostics.h): энергия, импульс,
+//                        растяжение; --max-energy-drift/--max-stretch/... останавливают
+//                        прогон с кодом 3, --csv - история выборок
+//  --sweep <file>        перебор двойного маятника по сетке параметров в рабочих
+//                        процессах, результаты в общем файле (sweep.h)
+bool run_headless(int argc, char* argv[], int& exit_code);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef JACOBI_SOLVER_H
+#define JACOBI_SOLVER_H
+
+#include <cstddef>
+#include <vector>
+
+struct Particle;
+struct Constraint;
+class TaskScheduler;
+
+//решатель Якоби для связей расстояния: все связи итерации считаются от одних и тех же
+//позиций, поправки складываются в частицы и делятся на число их связей;
+//связи хранятся столбцами (SoA), так что основной цикл векторизуется
+class JacobiSolver {
+public:
+    void build(const std::vector<Particle>& particles, const std::vector<Constraint>& constraints);
+
+    //одна итерация; omega - верхняя релаксация (1 - обычное усреднение);
+    //результат не зависит от числа потоков и размера кусков
+    void iterate(std::vector<Particle>& particles, double omega, TaskScheduler* scheduler, size_t grain);
+
+    size_t constraintCount() const { return rest.size(); }
+
+private:
+    //связь k: частицы i1[k], i2[k], длина rest[k], доли поправки w1[k], w2[k];
+    //floor[k] = 0 у верёвок (тянут только растянутые), -inf у остальных
+    std::vector<size_t> i1, i2;
+    std::vector<double> rest, floor, w1, w2;
+
+    //поправка связи на текущей итерации (d * err / len)
+    std::vector<double> dx, dy;
+
+    //связи частицы p: incident[incident_start[p] .. incident_start[p + 1]);
+    //incident_w - доля поправки со знаком (+w1 для первой частицы, -w2 для второй)
+    std::vector<size_t> incident_start;
+    std::vector<size_t> incident;
+    std::vector<double> incident_w;
+    std::vector<double> inv_count;
+};
+
+#endif
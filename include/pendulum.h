@@ -5,6 +5,7 @@
 #include <array>
 #include <SFML/Graphics.hpp>
 #include "physics_engine.h"
+#include "physics_thread.h"
 #include "Vec2D.h"
 #include <iostream>
 #include "visual_config.h"
@@ -19,6 +20,48 @@ private:
     PhysicsEngine& engine;
     sf::RenderWindow& win;
 
+    //версия топологии, по которой построены circles/links (режим потока физики)
+    size_t proxies_version = size_t(-1);
+
+    //статическая геометрия движка; перестраивается только при её изменении
+    std::vector<sf::Vertex> collider_lines;
+    std::vector<sf::CircleShape> collider_circles;
+    size_t colliders_version = size_t(-1);
+
+    void rebuild_colliders() {
+        const StaticColliders& colliders = engine.getColliders();
+        collider_lines.clear();
+        collider_circles.clear();
+        const sf::Color color(140, 140, 150);
+        for (size_t i = 0; i < colliders.size(); i++) {
+            const StaticColliders::Primitive& p = colliders.primitive(i);
+            if (p.kind == StaticColliders::Kind::Segment) {
+                collider_lines.push_back(sf::Vertex{sf::Vector2f(p.a.x, p.a.y), color});
+                collider_lines.push_back(sf::Vertex{sf::Vector2f(p.b.x, p.b.y), color});
+                continue;
+            }
+            sf::CircleShape circle(p.radius);
+            circle.setOrigin({float(p.radius), float(p.radius)});
+            circle.setPosition(sf::Vector2f(p.a.x, p.a.y));
+            circle.setFillColor(sf::Color::Transparent);
+            circle.setOutlineColor(color);
+            circle.setOutlineThickness(2.0f);
+            collider_circles.push_back(circle);
+        }
+        colliders_version = colliders.version();
+    }
+
+    //число вершин круга; на слабой машине меньше (см. set_detail)
+    size_t circle_points = 30;
+
+    sf::CircleShape make_circle(const sf::Vector2f& position, bool isfixed) const {
+        sf::CircleShape circle(Config::RADIUS, circle_points);
+        circle.setOrigin({Config::RADIUS, Config::RADIUS});
+        circle.setPosition(position);
+        circle.setFillColor(isfixed ? sf::Color(180, 100, 60) : sf::Color::Red);
+        return circle;
+    }
+
 public:
     Pendulum(PhysicsEngine& eng, sf::RenderWindow& win) : engine{eng}, win{win} {}
     Pendulum() = delete;
@@ -43,65 +86,55 @@ public:
         win.draw(temp_circle);
     }
 
-    void change_state(size_t i, double mass, double velosity, bool remove = false){
-       
-        if(remove){
-            links.erase(links.end() - engine.getConstraintCount_with(i), links.end());
-            engine.removeParticle(i);
-            circles.erase(circles.begin() + i);
-
-            return;
-        }
-
-        Particle& p = engine.getParticle(i);
-        p.setMass(mass);
+    //правка массы и скорости только в движке (годится и для команды потоку физики)
+    static void apply_state(PhysicsEngine& eng, size_t i, double mass, double velosity) {
+        eng.setParticleMass(i, mass);
+        Particle& p = eng.getParticle(i);
 
         p.velocity = (leight(p.velocity) > 0.00001) ? 
              (p.velocity / leight(p.velocity)) * velosity : 
               Vec2d(1.0, 0.0) * velosity;
-
+        eng.discardFutureSnapshots();
     }
-    
-    void create_pendulum(const sf::Vector2f& position, size_t constraint_with, 
-                    double length, double mass, double velosity, bool isfixed = 0) {
-        
-        Vec2d pos{position.x, position.y};
-        Vec2d pos2 = (engine.getParticle(constraint_with)).position;
+
+    //новая частица со связью в очередь правок движка, возвращает её индекс в пачке;
+    //графика появится, когда движок применит пачку (через remap_particles)
+    static size_t spawn_particle(PhysicsEngine& eng, const Vec2d& pos, size_t constraint_with,
+                                 double length, double mass, double velosity, bool isfixed = 0) {
+        Vec2d pos2 = (eng.getParticle(constraint_with)).position;
         Vec2d vector_between = (pos-pos2)/leight(pos-pos2);
         Vec2d vec_velosity;
         vec_velosity.x = -vector_between.y;
         vec_velosity.y = vector_between.x;
         vec_velosity *= velosity;
 
-        size_t new_particle_idx = engine.createParticle(pos, mass, vec_velosity, isfixed);
-        default_particles.push_back(Particle(pos, mass, vec_velosity));
-        
-        sf::CircleShape circle(Config::RADIUS);
-        circle.setOrigin({Config::RADIUS, Config::RADIUS});
-        circle.setPosition(position);
-        circle.setFillColor(sf::Color::Red);
-        circles.push_back(circle);
-        
-        if (engine.getParticleCount() >= 1) {
-            size_t existing_idx = constraint_with;
-            
-            if (existing_idx != new_particle_idx) {
-                try {
-                    engine.createConstraint(existing_idx, new_particle_idx, length);
-                    
-                    //создаём графическую связь
-                    std::array<sf::Vertex, 2> link;
-                    link[0].position = circles[constraint_with].getPosition();
-                    link[1].position = position;
-                    link[0].color = sf::Color::Cyan;
-                    link[1].color = sf::Color::Cyan;
-                    links.push_back(link);
-                }
-                catch (const std::invalid_argument& e) {
-                    std::cerr << "Failed to create constraint: " << e.what() << std::endl;
-                }
-            }
+        TopologyEdits& edits = eng.edits();
+        size_t new_particle_idx = edits.addParticle(pos, mass, vec_velosity, isfixed);
+        try {
+            edits.addConstraint(constraint_with, new_particle_idx, length);
         }
+        catch (const std::invalid_argument& e) {
+            std::cerr << "Failed to create constraint: " << e.what() << std::endl;
+        }
+        return new_particle_idx;
+    }
+
+    void change_state(size_t i, double mass, double velosity, bool remove = false){
+       
+        if(remove){
+            //частица, её связи и графика уйдут вместе с остальными правками кадра
+            engine.edits().removeParticle(i);
+            return;
+        }
+
+        apply_state(engine, i, mass, velosity);
+    }
+    
+    void create_pendulum(const sf::Vector2f& position, size_t constraint_with, 
+                    double length, double mass, double velosity, bool isfixed = 0) {
+        
+        Vec2d pos{position.x, position.y};
+        spawn_particle(engine, pos, constraint_with, length, mass, velosity, isfixed);
     }
     
     void create_firs_part( const sf::Vector2f& position, size_t constraint_with, 
@@ -112,15 +145,73 @@ public:
         size_t new_particle_idx = engine.createParticle(pos, mass, {0, 0}, isfixed);
         default_particles.push_back(Particle(pos, mass, {0, 0}));
         
-        sf::CircleShape circle(Config::RADIUS);
-        circle.setOrigin({Config::RADIUS, Config::RADIUS});
-        circle.setPosition(position);
-        circle.setFillColor(sf::Color(180, 100, 60));
-        circles.push_back(circle);
+        circles.push_back(make_circle(position, true));
         
     }
 
+    //графика для всего, что добавили пакетные построители движка:
+    //места под circles/links/default_particles выделяются один раз
+    void build_proxies() {
+        size_t particle_count = engine.getParticleCount();
+        size_t constraint_count = engine.getConstraintCount();
+        circles.reserve(particle_count);
+        default_particles.reserve(particle_count);
+        links.reserve(constraint_count);
+
+        for (size_t i = circles.size(); i < particle_count; i++) {
+            const Particle& p = engine.getParticle(i);
+            circles.push_back(make_circle({static_cast<float>(p.position.x),
+                                           static_cast<float>(p.position.y)}, p.fixed));
+            default_particles.push_back(p);
+        }
+        for (size_t i = links.size(); i < constraint_count; i++) {
+            size_t i1, i2;
+            engine.getConstraint(i).getIndexes(i1, i2);
+            std::array<sf::Vertex, 2> link;
+            link[0].position = circles[i1].getPosition();
+            link[1].position = circles[i2].getPosition();
+            link[0].color = sf::Color::Cyan;
+            link[1].color = sf::Color::Cyan;
+            links.push_back(link);
+        }
+    }
+
+    //движок перенумеровал частицы или применил пачку правок - переставляем свои копии
+    //под новый порядок за один проход; новые частицы (NO_PARTICLE) берём из движка.
+    //links берут индексы из связей движка на каждом кадре, нужно только их число
+    void remap_particles(const ReorderMap& map) {
+        std::vector<sf::CircleShape> moved_circles;
+        std::vector<Particle> moved_defaults;
+        moved_circles.reserve(map.old_of_new.size());
+        moved_defaults.reserve(map.old_of_new.size());
+        for (size_t new_idx = 0; new_idx < map.old_of_new.size(); new_idx++) {
+            size_t old_idx = map.old_of_new[new_idx];
+            if (old_idx < circles.size()) {
+                moved_circles.push_back(circles[old_idx]);
+            } else if (new_idx < engine.getParticleCount()) {
+                const Particle& p = engine.getParticle(new_idx);
+                moved_circles.push_back(make_circle({static_cast<float>(p.position.x),
+                                                     static_cast<float>(p.position.y)}, p.fixed));
+            }
+            if (old_idx < default_particles.size()) {
+                moved_defaults.push_back(default_particles[old_idx]);
+            } else if (new_idx < engine.getParticleCount()) {
+                moved_defaults.push_back(engine.getParticle(new_idx));
+            }
+        }
+        circles.swap(moved_circles);
+        default_particles.swap(moved_defaults);
+
+        std::array<sf::Vertex, 2> link;
+        link[0].color = sf::Color::Cyan;
+        link[1].color = sf::Color::Cyan;
+        links.resize(engine.getConstraintCount(), link);
+    }
+
     void restart_animation() {
+        //пока топология не менялась, начальное состояние лежит в снимках движка
+        if (engine.seekStep(0)) return;
+
         for (size_t i = 0; i < default_particles.size() && i < engine.getParticleCount(); i++) {
             auto& p = engine.getParticle(i);
             p.position = default_particles[i].position;
@@ -129,6 +220,13 @@ public:
         engine.reset_time();
     }
 
+    //перемотка на delta шагов (отрицательное - назад), false - нет снимка
+    bool scrub(long long delta) {
+        if (!engine.seekRelative(delta)) return false;
+        update_animation();
+        return true;
+    }
+
     void update_animation() {
         for (size_t i = 0; i <engine.getParticleCount(); ++i) {
             const auto& particle = engine.getParticle(i);
@@ -149,7 +247,54 @@ public:
         }
     }
     
+    //режим потока физики: берём позиции из готового кадра,
+    //при смене топологии пересобираем circles/links целиком
+    void sync_from_snapshot(const EngineSnapshot& s) {
+        if (s.topology_version != proxies_version) {
+            circles.clear();
+            circles.reserve(s.positions.size());
+            for (size_t i = 0; i < s.positions.size(); i++) {
+                circles.push_back(make_circle({0, 0}, i < s.fixed.size() && s.fixed[i]));
+            }
+            links.assign(s.links.size(), {});
+            for (auto& link : links) {
+                link[0].color = sf::Color::Cyan;
+                link[1].color = sf::Color::Cyan;
+            }
+            proxies_version = s.topology_version;
+        }
+
+        for (size_t i = 0; i < circles.size() && i < s.positions.size(); i++) {
+            circles[i].setPosition({
+                static_cast<float>(s.positions[i].x),
+                static_cast<float>(s.positions[i].y)
+            });
+        }
+        for (size_t i = 0; i < links.size(); i++) {
+            links[i][0].position = circles[s.links[i].first].getPosition();
+            links[i][1].position = circles[s.links[i].second].getPosition();
+        }
+    }
+
+    //детализация отрисовки: false - грубые круги, когда не хватает времени на кадр
+    void set_detail(bool high) {
+        size_t points = high ? 30 : 10;
+        if (points == circle_points) return;
+        circle_points = points;
+        for (auto& circle : circles) {
+            circle.setPointCount(points);
+        }
+    }
+
     void draw_all() {
+        if (colliders_version != engine.getColliders().version()) rebuild_colliders();
+        if (!collider_lines.empty()) {
+            win.draw(collider_lines.data(), collider_lines.size(), sf::PrimitiveType::Lines);
+        }
+        for (const auto& circle : collider_circles) {
+            win.draw(circle);
+        }
+
         for (const auto& link : links) {
             win.draw(&link[0], 2, sf::PrimitiveType::Lines);
         }
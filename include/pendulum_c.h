@@ -0,0 +1,103 @@
+#ifndef PENDULUM_C_H
+#define PENDULUM_C_H
+
+/*
+ * C ABI движка для внешних программ (Python ctypes/cffi, Julia, Rust ...).
+ * Исключения наружу не выходят: функции возвращают код ошибки, текст
+ * последней ошибки потока - pendulum_last_error().
+ *
+ * Состояние читается на месте: view-функции отдают указатели прямо в массив
+ * частиц движка и шаг между соседними частицами в байтах. Указатели живут до
+ * следующего изменения набора частиц (add/remove/clear).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(PENDULUM_C_BUILD)
+#    define PENDULUM_C_API __declspec(dllexport)
+#  else
+#    define PENDULUM_C_API __declspec(dllimport)
+#  endif
+#else
+#  define PENDULUM_C_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* растёт при несовместимых изменениях ABI */
+#define PENDULUM_C_API_VERSION 2
+
+typedef struct pendulum_engine pendulum_engine;
+
+enum {
+    PENDULUM_OK = 0,
+    PENDULUM_ERROR_INVALID_ARGUMENT = -1,
+    PENDULUM_ERROR_OUT_OF_RANGE = -2,
+    PENDULUM_ERROR_INTERNAL = -3
+};
+
+/* count векторов: x[i] = *(double*)((char*)x + i * stride), y - так же */
+typedef struct pendulum_vec2_view {
+    double* x;
+    double* y;
+    size_t count;
+    size_t stride;
+} pendulum_vec2_view;
+
+/* count скаляров с тем же шагом stride, только для чтения */
+typedef struct pendulum_const_scalar_view {
+    const double* data;
+    size_t count;
+    size_t stride;
+} pendulum_const_scalar_view;
+
+PENDULUM_C_API int pendulum_api_version(void);
+PENDULUM_C_API const char* pendulum_last_error(void);
+
+/* NULL при ошибке */
+PENDULUM_C_API pendulum_engine* pendulum_create(double gravity_x, double gravity_y, double dt,
+                                                int iterations, double damping);
+PENDULUM_C_API void pendulum_destroy(pendulum_engine* engine);
+PENDULUM_C_API int pendulum_clear(pendulum_engine* engine);
+
+/* xy - 2*count чисел (x0, y0, x1, y1, ...); masses/fixed могут быть NULL;
+ * first_index (может быть NULL) - индекс первой добавленной частицы */
+PENDULUM_C_API int pendulum_add_particles(pendulum_engine* engine, const double* xy, const double* masses,
+                                          const uint8_t* fixed, size_t count, size_t* first_index);
+/* pairs - 2*count индексов; lengths NULL - текущее расстояние, stiffness NULL - 1 */
+PENDULUM_C_API int pendulum_add_constraints(pendulum_engine* engine, const size_t* pairs,
+                                            const double* lengths, const double* stiffness, size_t count);
+
+PENDULUM_C_API int pendulum_step(pendulum_engine* engine, size_t steps);
+
+PENDULUM_C_API int pendulum_set_gravity(pendulum_engine* engine, double x, double y);
+PENDULUM_C_API int pendulum_set_time_step(pendulum_engine* engine, double dt);
+PENDULUM_C_API int pendulum_set_iterations(pendulum_engine* engine, int iterations);
+PENDULUM_C_API int pendulum_set_damping(pendulum_engine* engine, double damping);
+/* 0 - по числу ядер, 1 - без пула; результат от числа потоков не зависит */
+PENDULUM_C_API int pendulum_set_thread_count(pendulum_engine* engine, unsigned threads);
+/* масса одной частицы; веса связей пересчитываются перед следующим шагом */
+PENDULUM_C_API int pendulum_set_mass(pendulum_engine* engine, size_t index, double mass);
+
+PENDULUM_C_API size_t pendulum_particle_count(const pendulum_engine* engine);
+PENDULUM_C_API size_t pendulum_constraint_count(const pendulum_engine* engine);
+PENDULUM_C_API double pendulum_time(const pendulum_engine* engine);
+PENDULUM_C_API uint64_t pendulum_step_count(const pendulum_engine* engine);
+PENDULUM_C_API uint64_t pendulum_topology_version(const pendulum_engine* engine);
+PENDULUM_C_API uint64_t pendulum_state_hash(const pendulum_engine* engine);
+
+/* позиции и скорости через view можно записывать; массы только читать -
+ * для записи pendulum_set_mass */
+PENDULUM_C_API int pendulum_positions(pendulum_engine* engine, pendulum_vec2_view* out);
+PENDULUM_C_API int pendulum_velocities(pendulum_engine* engine, pendulum_vec2_view* out);
+PENDULUM_C_API int pendulum_inverse_masses(const pendulum_engine* engine, pendulum_const_scalar_view* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
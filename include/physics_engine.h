@@ -3,8 +3,21 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include "Vec2D.h"
 #include <memory>
+#include <functional>
+#include "task_scheduler.h"
+#include "snapshot_ring.h"
+#include "force_fields.h"
+#include "constraint_batches.h"
+#include "jacobi_solver.h"
+#include "cg_solver.h"
+#include "colliders.h"
+#include "topology_edits.h"
+#include "diagnostics.h"
+#include <cstdint>
+#include <utility>
 
 
 struct Particle{
@@ -15,8 +28,6 @@ struct Particle{
     bool fixed;
 
     void setMass(double mass) {
-
-        std::cout<<mass;
         if (mass <= 0.0) {
             inv_mass = 0.0;
         } else {
@@ -30,8 +41,6 @@ struct Particle{
     Particle(const Vec2d pos = {0, 0}, double mass = 1.0, Vec2d vel = {0 , 0}, bool is_fixed = false)
         : position(pos), predicted_position(pos), velocity(vel), fixed(is_fixed) {
         setMass(mass);
-
-        std::cout<<"\n"<<velocity.x<< " "<< velocity.y<<"\n";
     }
     
     void set_velocity(Vec2d vel){velocity = vel;}
@@ -43,15 +52,20 @@ struct Particle{
     }
 };
 
+//Distance - держит расстояние, Rope - не даёт только растянуться
+enum class ConstraintKind { Distance, Rope };
+
 struct Constraint {
     size_t particle1_idx;
     size_t particle2_idx;
     double target_length;
     double stiffness; // жёсткость [0, 1]
+    ConstraintKind kind;
     
-    Constraint(size_t idx1, size_t idx2, double length, double stiff = 1.0)
+    Constraint(size_t idx1, size_t idx2, double length, double stiff = 1.0,
+               ConstraintKind k = ConstraintKind::Distance)
         : particle1_idx(idx1), particle2_idx(idx2), 
-          target_length(length), stiffness(stiff) {
+          target_length(length), stiffness(stiff), kind(k) {
         if (length <= 0.0) {
             throw std::invalid_argument("Constraint length must be positive");
         }
@@ -69,16 +83,162 @@ struct Constraint {
     void getIndexes(size_t& i1, size_t& i2) const {i1 = particle1_idx; i2 = particle2_idx;}
 };
 
+//угол a-center-b держится в [min_angle, max_angle] (радианы, 0..pi)
+struct AngleConstraint {
+    size_t a;
+    size_t center;
+    size_t b;
+    double min_angle;
+    double max_angle;
+    double stiffness;
+
+    bool contains(size_t idx) const { return a == idx || center == idx || b == idx; }
+};
+
+//какие частицы и связи добавил один пакетный построитель сцены
+struct SceneRange {
+    size_t first_particle = 0;
+    size_t particle_count = 0;
+    size_t first_constraint = 0;
+    size_t constraint_count = 0;
+};
+
+//GaussSeidel - связи по очереди на месте (быстро сходится);
+//Jacobi - все связи итерации от одних позиций (векторизуется, сходится медленнее);
+//ConjugateGradient - все связи разом одной линейной системой (жёсткие сетки с циклами)
+enum class SolverMode { GaussSeidel, Jacobi, ConjugateGradient };
+
+//порядок частиц в памяти по связности графа связей
+enum class ReorderMethod { None, BFS, ReverseCuthillMcKee };
+
+//перенумерация: new_of_old[старый] = новый, old_of_new[новый] = старый;
+//после пачки правок у удалённых и новых частиц там NO_PARTICLE
+constexpr size_t NO_PARTICLE = size_t(-1);
+
+struct ReorderMap {
+    std::vector<size_t> new_of_old;
+    std::vector<size_t> old_of_new;
+};
+
+template <size_t K>
+class TangentStepper;
+
 class PhysicsEngine {
 private:
+    //шаг с касательными повторяет step() над внутренним состоянием
+    template <size_t K>
+    friend class TangentStepper;
+
     std::vector<Particle> particles;
     std::vector<Constraint> constraints;
+    std::vector<AngleConstraint> angle_constraints;
     
     Vec2d gravity{0.0, 100.0};  // Гравитация в пикселях/с² позже надо будет чтото сделать с этим ужасом
     double time_step = 0.016;
     double current_time = 0.0;
+    std::uint64_t step_count = 0;
     int solver_iterations = 10;
     double damping = 0;
+
+    //общий пул потоков (nullptr - всё считается в вызывающем потоке)
+    std::shared_ptr<TaskScheduler> scheduler;
+    size_t parallel_grain = 2048;
+
+    //след хэшей состояния: (номер шага, хэш) каждые hash_interval шагов
+    size_t hash_interval = 0;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> hash_trace;
+
+    //поля сил, считаются перед предсказанием позиций
+    std::vector<std::shared_ptr<ForceField>> force_fields;
+    std::vector<Vec2d> field_forces;
+    void accumulateFieldForces();
+
+    //снимки состояния для перемотки назад
+    SnapshotRing snapshots;
+
+    //энергии, импульс и растяжение связей после шага
+    Diagnostics diagnostics;
+
+    //растёт при любом изменении набора частиц/связей
+    size_t topology_version = 0;
+    //растёт при смене масс и параметров шага (решатель и его настройки, затухание,
+    //гравитация, радиус и геометрия столкновений, поля сил; dt и итерации хранятся
+    //в самих снимках): снимки, посчитанные с другими, не годятся
+    size_t params_version = 0;
+    //правки полей и препятствий идут мимо движка - их номера сверяются перед шагом
+    std::uint64_t seen_field_revision = 0;
+    size_t seen_colliders_version = 0;
+    void syncParamsVersion();
+
+    //связи по видам и островам (острова независимы и решаются параллельно);
+    //пересобираются при смене топологии или масс
+    ConstraintBatches batches;
+    size_t batches_version = size_t(-1);
+    bool weights_dirty = true;
+
+    SolverMode solver_mode = SolverMode::GaussSeidel;
+    JacobiSolver jacobi;
+    bool jacobi_ready = false;
+    double jacobi_omega = 1.5;
+
+    //в режиме CG solver_iterations - число линеаризаций за шаг
+    CGSolver cg;
+    bool cg_ready = false;
+    int cg_max_iterations = 30;
+    double cg_tolerance = 1e-4;
+
+    //неподвижная геометрия; частица для столкновений - круг collision_radius
+    StaticColliders colliders;
+    double collision_radius = 0.0;
+
+    //перенумерация после смены топологии (None - только вручную);
+    //внешние индексы пересчитывает слушатель
+    ReorderMethod auto_reorder = ReorderMethod::None;
+    size_t reorder_version = size_t(-1);
+    std::function<void(const ReorderMap&)> reorder_listener;
+
+    //правки топологии за кадр, применяются перед следующим шагом
+    TopologyEdits pending_edits;
+
+    //пакетное построение: одно выделение памяти и линейное заполнение
+    //без проверки дубликатов (построители их не создают)
+    SceneRange beginBulk(size_t particle_count, size_t constraint_count);
+    void endBulk(SceneRange& range);
+    size_t appendParticle(const Vec2d& position, double mass, bool fixed = false);
+    void appendConstraint(size_t idx1, size_t idx2, double stiffness = 1.0);
+
+    //общее для step() и TangentStepper::step(): до шага - правки, перенумерация и
+    //снимок; после - время, номер шага, диагностика и след хэшей
+    void beginStep();
+    void endStep();
+    //снимок перед шагом, если он нужен (и при перемотке)
+    void recordSnapshot();
+    //шаги 0-4 без учёта времени и номера шага
+    void solveStep();
+
+    void solveConstraints();
+    //пересобрать пакеты связей, если менялись топология или массы
+    void prepareBatches();
+    //iterations итераций выбранным решателем; first - первый проход за шаг
+    void solvePass(int iterations, bool first);
+    void solveIslands(int iterations);
+    void solveJacobi(int iterations);
+    void solveCG(int iterations, bool warm_start);
+    //множители CG, с которых начнётся следующий шаг (для снимка перемотки)
+    const std::vector<double>& snapshotWarmStart() const {
+        static const std::vector<double> none;
+        return solver_mode == SolverMode::ConjugateGradient && cg_ready ? cg.warmStart() : none;
+    }
+    void forEachParticle(const std::function<void(size_t, size_t)>& fn);
+    //размер куска для параллельной работы над n элементами
+    size_t workGrain(size_t n) const;
+    //место ещё под extra элементов; если не хватает - ёмкость хотя бы удваивается,
+    //иначе серия мелких пакетов перевыделяла бы весь массив на каждом
+    template <typename T>
+    static void reserveExtra(std::vector<T>& v, size_t extra) {
+        size_t need = v.size() + extra;
+        if (need > v.capacity()) v.reserve(std::max(need, 2 * v.capacity()));
+    }
     
 public:
     PhysicsEngine() = default;
@@ -97,6 +257,7 @@ public:
     //создание частицы
     size_t createParticle(const Vec2d& position, double mass = 1.0, Vec2d velosity = {0, 0}, bool fixed = false) {
         particles.emplace_back(position, mass, velosity, fixed);
+        topology_version++;
         return particles.size() - 1;
     }
     
@@ -105,6 +266,25 @@ public:
     
     //создание связи
     void createConstraint(size_t idx1, size_t idx2, double length, double stiffness = 1.0);
+    //верёвка: не даёт расстоянию стать больше max_length, сжиматься можно
+    void createRopeConstraint(size_t idx1, size_t idx2, double max_length, double stiffness = 1.0);
+    //ограничение угла a-center-b
+    void createAngleConstraint(size_t a, size_t center, size_t b, double min_angle, double max_angle,
+                               double stiffness = 1.0);
+
+    //смена массы/закрепления через движок - чтобы пересчитать веса связей
+    void setParticleMass(size_t idx, double mass) {
+        particles[idx].setMass(mass);
+        weights_dirty = true;
+        params_version++;
+    }
+    //у закреплённой частицы масса не хранится, при откреплении она станет 1
+    void setParticleFixed(size_t idx, bool fixed) {
+        Particle& p = particles[idx];
+        p.fixed = fixed;
+        p.inv_mass = fixed ? 0.0 : (p.inv_mass > 0.0 ? p.inv_mass : 1.0);
+        topology_version++;
+    }
     
     //основной метод симуляции "PBD" (вельвет говно)
     void step();
@@ -115,29 +295,193 @@ public:
     const Particle& getParticle(size_t idx) const { return particles[idx]; }
     size_t getConstraintCount() const { return constraints.size(); }
     const Constraint& getConstraint(size_t idx) const { return constraints[idx]; }
+    size_t getAngleConstraintCount() const { return angle_constraints.size(); }
+    const AngleConstraint& getAngleConstraint(size_t idx) const { return angle_constraints[idx]; }
+    const ConstraintBatches& getBatches() const { return batches; }
     int getConstraintCount_with(size_t idx);
     double getTime() const { return current_time; }
+    std::uint64_t getStepCount() const { return step_count; }
     double getTimeStep() const { return time_step; }
+    int getSolverIterations() const { return solver_iterations; }
+    size_t getTopologyVersion() const { return topology_version; }
+    const std::shared_ptr<TaskScheduler>& getScheduler() const { return scheduler; }
+    unsigned getThreadCount() const { return scheduler ? scheduler->concurrency() : 1; }
     
     //сеттеры
-    void setGravity(const Vec2d& grav) { gravity = grav; }
+    void setGravity(const Vec2d& grav) {
+        if (grav.x != gravity.x || grav.y != gravity.y) params_version++;
+        gravity = grav;
+    }
+    //dt и итерации хранятся в снимках перемотки, их смена историю не сбрасывает
     void setTimeStep(double dt) { if (dt > 0.0) time_step = dt; }
     void setSolverIterations(int iter) { if (iter > 0) solver_iterations = iter; }
-    void setDamping(double damp) { damping = std::max(0.0, damp); }
-    void setParticle(std::vector<Particle> setter) { particles = setter; }
-    void reset_time(){current_time = 0;}
+    void setDamping(double damp) {
+        damp = std::max(0.0, damp);
+        if (damp != damping) { damping = damp; params_version++; }
+    }
+    void setParticle(std::vector<Particle> setter) { particles = setter; topology_version++; }
+    void reset_time(){current_time = 0; step_count = 0;}
+
+    //потоки: n считается вместе с вызывающим, 1 - без пула, 0 - по числу ядер
+    void setThreadCount(unsigned n, bool pin_threads = false);
+    //подключить уже существующий пул (один на всю симуляцию)
+    void setScheduler(std::shared_ptr<TaskScheduler> sched) { scheduler = std::move(sched); }
+    //минимальный кусок частиц на одну задачу
+    void setParallelGrain(size_t grain) { if (grain > 0) parallel_grain = grain; }
+    //сколько воркеры крутятся между кадрами, прежде чем заснуть
+    void setThreadSpinTime(std::chrono::microseconds spin) { if (scheduler) scheduler->setSpinTime(spin); }
+
+    //способ решения связей; omega - верхняя релаксация Якоби в (0, 2)
+    void setSolverMode(SolverMode mode) {
+        if (mode != solver_mode) { solver_mode = mode; params_version++; }
+    }
+    SolverMode getSolverMode() const { return solver_mode; }
+    void setJacobiRelaxation(double omega) {
+        if (omega > 0.0 && omega < 2.0 && omega != jacobi_omega) { jacobi_omega = omega; params_version++; }
+    }
+    //CG: предел шагов на одну линеаризацию и относительная невязка для останова
+    void setCGParameters(int max_iterations, double tolerance) {
+        if (max_iterations > 0 && max_iterations != cg_max_iterations) {
+            cg_max_iterations = max_iterations;
+            params_version++;
+        }
+        if (tolerance > 0.0 && tolerance != cg_tolerance) {
+            cg_tolerance = tolerance;
+            params_version++;
+        }
+    }
+    int getLastCGIterations() const { return cg.lastIterations(); }
+
+    //статические препятствия (пол, стены, ломаные); радиус частицы при столкновениях
+    StaticColliders& getColliders() { return colliders; }
+    const StaticColliders& getColliders() const { return colliders; }
+    void setCollisionRadius(double r) {
+        r = std::max(0.0, r);
+        if (r != collision_radius) { collision_radius = r; params_version++; }
+    }
+    double getCollisionRadius() const { return collision_radius; }
+
+    //результат побитово одинаков при любом числе потоков и любом разбиении работы:
+    //острова и частицы Якоби считаются независимо, суммы CG и хэш сводятся по кускам
+    //фиксированного размера. Отдельного детерминированного режима нет
+    //хэш (XXH64) позиций и скоростей всех частиц; не зависит от числа потоков
+    std::uint64_t stateHash() const;
+    //записывать хэш каждые n шагов (0 - выключено)
+    void setHashInterval(size_t n) { hash_interval = n; }
+    const std::vector<std::pair<std::uint64_t, std::uint64_t>>& getHashTrace() const { return hash_trace; }
+    void clearHashTrace() { hash_trace.clear(); }
+
+    //снимок каждые every_k_steps шагов в кольцо размером до memory_budget байт (0 - выключить)
+    void enableSnapshots(size_t memory_budget, size_t every_k_steps) {
+        snapshots.configure(memory_budget, every_k_steps);
+    }
+    const SnapshotRing& getSnapshots() const { return snapshots; }
+    //вернуться к шагу target: восстановить ближайший снимок и досчитать вперёд (без
+    //записи диагностики и хэшей); false - есть неприменённые правки или нет снимка
+    //после последней смены топологии, масс или параметров шага
+    bool seekStep(std::uint64_t target);
+    //перемотка на delta шагов от текущего (отрицательное - назад)
+    bool seekRelative(long long delta) {
+        if (delta < 0 && std::uint64_t(-delta) > step_count) return seekStep(0);
+        return seekStep(step_count + delta);
+    }
+    //после ручной правки состояния записанное будущее больше не верно
+    void discardFutureSnapshots() { snapshots.truncateAfter(step_count); }
+
+    //диагностика каждые every_k_steps шагов, последние history выборок (0 - выключить);
+    //пороги и история - через getDiagnostics()
+    void enableDiagnostics(size_t history, size_t every_k_steps) {
+        diagnostics.configure(history, every_k_steps);
+    }
+    Diagnostics& getDiagnostics() { return diagnostics; }
+    const Diagnostics& getDiagnostics() const { return diagnostics; }
 
     //очистка
     void clear() {
         particles.clear();
         constraints.clear();
+        angle_constraints.clear();
         current_time = 0.0;
+        step_count = 0;
+        topology_version++;
     }
     
+    //заранее выделить место под ещё столько частиц и связей
+    void reserve(size_t extra_particles, size_t extra_constraints) {
+        reserveExtra(particles, extra_particles);
+        reserveExtra(constraints, extra_constraints);
+    }
+
     //прессеты
     size_t createSimplePendulum(const Vec2d& pivot, double length, double mass);
     void createDoublePendulum(const Vec2d& pivot, double l1, double l2, double m1, double m2);
+
+    //пакетные построители: закреплённая точка + links звеньев вдоль direction
+    SceneRange createChain(const Vec2d& pivot, size_t links, double link_length, double mass,
+                           const Vec2d& direction = {0, 1}, double stiffness = 1.0);
+    //верёвка от закреплённой точки from до свободного конца to
+    SceneRange createRope(const Vec2d& from, const Vec2d& to, size_t segments, double total_mass,
+                          double stiffness = 1.0);
+    //двоичное дерево глубины depth, корень закреплён, частицы в порядке обхода в ширину
+    SceneRange createBinaryTree(const Vec2d& root, size_t depth, double length, double mass,
+                                double spread);
+    //сетка ткани cols x rows построчно, верхний ряд закреплён при pin_top
+    SceneRange createClothGrid(const Vec2d& origin, size_t cols, size_t rows, double spacing,
+                               double mass, double stiffness = 1.0, bool pin_top = true);
+    //count маятников по links_per_pendulum звеньев, отклонённых на angle
+    SceneRange createPendulumArray(const Vec2d& first_pivot, const Vec2d& pivot_spacing, size_t count,
+                                   size_t links_per_pendulum, double link_length, double mass,
+                                   double angle = 0.0);
+
+    //пакетное добавление из готовых массивов (для внешних программ);
+    //masses/fixed могут быть nullptr - масса 1, не закреплена
+    SceneRange addParticles(const Vec2d* positions, size_t count, const double* masses = nullptr,
+                            const std::uint8_t* fixed = nullptr);
+    //pairs - 2*count индексов; lengths nullptr - текущее расстояние, stiffness nullptr - 1;
+    //всё проверяется заранее, при ошибке ничего не добавляется; дубликаты не ищутся
+    SceneRange addConstraints(const size_t* pairs, size_t count, const double* lengths = nullptr,
+                              const double* stiffness = nullptr);
+
+    //прямой доступ к массиву частиц; указатель живёт до смены топологии
+    Particle* particleData() { return particles.data(); }
+    const Particle* particleData() const { return particles.data(); }
     
+    //перенумеровать частицы обходом графа связей, чтобы соседи по связям лежали в памяти
+    //рядом; порядок связей сохраняется, результат решателя Гаусса-Зейделя не меняется.
+    //false - порядок уже такой
+    bool reorderForLocality(ReorderMethod method = ReorderMethod::ReverseCuthillMcKee);
+    //делать это перед шагом, если с прошлого раза менялась топология
+    void setAutoReorder(ReorderMethod method) { auto_reorder = method; }
+    ReorderMethod getAutoReorder() const { return auto_reorder; }
+    //вызывается после каждой перенумерации и пачки правок (хранящим свои индексы частиц)
+    void setReorderListener(std::function<void(const ReorderMap&)> fn) { reorder_listener = std::move(fn); }
+
+    //очередь правок топологии: копится между шагами, применяется одной пачкой
+    //в начале step() или явно через commitEdits()
+    TopologyEdits& edits() { return pending_edits; }
+    bool hasPendingEdits() const { return !pending_edits.empty(); }
+    //false - очередь была пуста или пачка отклонена (причина - в stderr, движок не тронут)
+    bool commitEdits();
+    //применить пачку сразу: один проход сжатия индексов, одно изменение топологии;
+    //неверный индекс - std::out_of_range до каких-либо изменений
+    ReorderMap applyEdits(const TopologyEdits& edits);
+
+    //поля сил (однородные, притяжение к точке, сопротивление, пружины, попарные)
+    void addForceField(std::shared_ptr<ForceField> field) {
+        force_fields.push_back(std::move(field));
+        params_version++;
+    }
+    void removeForceField(const std::shared_ptr<ForceField>& field) {
+        for (auto it = force_fields.begin(); it != force_fields.end(); ++it) {
+            if (*it == field) { force_fields.erase(it); params_version++; return; }
+        }
+    }
+    void clearForceFields() {
+        if (!force_fields.empty()) params_version++;
+        force_fields.clear();
+    }
+    size_t getForceFieldCount() const { return force_fields.size(); }
+
     //применение силы
     void applyForceToParticle(size_t idx, const Vec2d& force) {
         if (idx < particles.size()) {
@@ -0,0 +1,79 @@
+#ifndef PHYSICS_THREAD_H
+#define PHYSICS_THREAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "physics_engine.h"
+#include "triple_buffer.h"
+
+//то, что нужно отрисовке от одного шага движка
+struct EngineSnapshot {
+    std::vector<Vec2d> positions;
+    std::vector<Vec2d> velocities;
+    std::vector<double> inv_mass;
+
+    //топология копируется только когда она поменялась
+    std::vector<std::pair<size_t, size_t>> links;
+    std::vector<unsigned char> fixed;
+    size_t topology_version = size_t(-1);
+
+    double time = 0.0;
+    std::uint64_t step = 0;
+};
+
+//движок на отдельном потоке: шагает сам, состояние отдаёт через тройной буфер,
+//а все правки из интерфейса приходят командами и выполняются между шагами
+class PhysicsThread {
+public:
+    using Command = std::function<void(PhysicsEngine&)>;
+
+    explicit PhysicsThread(PhysicsEngine& eng) : engine(eng) {}
+    ~PhysicsThread() { stop(); }
+
+    PhysicsThread(const PhysicsThread&) = delete;
+    PhysicsThread& operator=(const PhysicsThread&) = delete;
+
+    void start();
+    void stop();
+
+    //команда выполнится на потоке физики перед следующим шагом
+    void post(Command cmd);
+
+    void setPaused(bool p);
+    bool isPaused() const { return paused.load(); }
+
+    //true - шагаем в темпе реального времени, false - так быстро, как можем
+    void setRealtime(bool r) { realtime.store(r); }
+
+    //последний готовый кадр, вызывать только из потока отрисовки
+    const EngineSnapshot& latest() { return snapshots.read(); }
+    bool hasNewSnapshot() const { return snapshots.hasNew(); }
+
+    std::uint64_t stepsDone() const { return steps.load(); }
+
+private:
+    void loop();
+    bool runCommands();
+    void publish();
+
+    PhysicsEngine& engine;
+    TripleBuffer<EngineSnapshot> snapshots;
+
+    std::thread worker;
+    std::mutex command_lock;
+    std::condition_variable command_cv;
+    std::vector<Command> commands;
+
+    std::atomic<bool> running{false};
+    std::atomic<bool> paused{true};
+    std::atomic<bool> realtime{true};
+    std::atomic<std::uint64_t> steps{0};
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef QUALITY_CONTROLLER_H
+#define QUALITY_CONTROLLER_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+class PhysicsEngine;
+
+//одна ступень качества: кадр считается substeps шагами по frame_dt / substeps,
+//в каждом iterations итераций решателя
+struct QualityLevel {
+    int substeps;
+    int iterations;
+};
+
+//подстраивает работу движка под бюджет кадра: меряет, сколько занял кадр физики,
+//и переходит по лестнице ступеней вниз (сразу, если бюджет превышен несколько кадров
+//подряд) или вверх (если следующая ступень по оценке долго укладывается с запасом).
+//Между порогами - полоса без переключений, неудачный подъём удваивает ожидание следующего
+class QualityController {
+public:
+    explicit QualityController(PhysicsEngine& eng, double frame_dt = 0.016);
+
+    //кадр физики: substeps шагов движка, время замеряется
+    void advance();
+
+    //бюджет на физику одного кадра, мс
+    void setBudget(double ms) { if (ms > 0.0) budget_ms = ms; }
+    double getBudget() const { return budget_ms; }
+    void setFrameTime(double dt);
+    //лестница от дешёвой к дорогой; текущая ступень - ближайшая к прежней по работе
+    void setLevels(std::vector<QualityLevel> ladder);
+    //нижняя граница точности: ниже этой ступени не опускаемся, даже не укладываясь в бюджет
+    void setMinLevel(size_t level);
+    //false - ступень только вручную через setLevel
+    void setAdaptive(bool a) { adaptive = a; }
+    void setLevel(size_t level);
+
+    size_t level() const { return current; }
+    size_t levelCount() const { return levels.size(); }
+    const QualityLevel& currentLevel() const { return levels[current]; }
+    //сглаженная цена кадра, мс
+    double averageCost() const { return avg_ms; }
+
+    //вызывается при смене ступени (например, чтобы упростить отрисовку)
+    void setLevelListener(std::function<void(size_t)> fn) { listener = std::move(fn); }
+
+private:
+    //относительная работа ступени: итерации плюс интегрирование на каждом подшаге
+    static double work(const QualityLevel& q) { return q.substeps * (q.iterations + 2.0); }
+    void adapt(double cost_ms);
+    void apply();
+
+    PhysicsEngine& engine;
+    double frame_dt;
+    double budget_ms = 8.0;
+
+    std::vector<QualityLevel> levels;
+    size_t current = 0;
+    size_t min_level = 0;
+    bool adaptive = true;
+
+    double avg_ms = 0.0;
+    bool have_avg = false;
+    int over_frames = 0;
+    int under_frames = 0;
+    int cooldown = 0;
+    //сколько кадров с запасом нужно для подъёма; растёт после подъёма, за которым сразу спуск
+    int up_frames = 30;
+    int frames_since_up = -1;
+
+    std::function<void(size_t)> listener;
+};
+
+#endif
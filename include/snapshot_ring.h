@@ -0,0 +1,88 @@
+#ifndef SNAPSHOT_RING_H
+#define SNAPSHOT_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Vec2D.h"
+
+struct Particle;
+
+//кольцевой буфер снимков состояния для перемотки назад.
+//Снимок хранит только то, что меняется от шага к шагу: позиции, скорости и
+//множители тёплого старта CG. Массы и закрепление внутри одной версии постоянны
+//(их правка поднимает версию), поэтому при перемотке они уже верны в частицах.
+//dt и число итераций (их меняет регулятор качества) хранятся в снимке: на шаге
+//их смены снимок пишется всегда, так что от снимка до следующего они постоянны.
+//Число снимков подбирается под бюджет памяти по размеру снимка
+class SnapshotRing {
+public:
+    struct Slot {
+        std::vector<Vec2d> positions;
+        std::vector<Vec2d> velocities;
+        //множители CG прошлого шага, пусто - шаг начнётся без тёплого старта
+        std::vector<double> warm;
+        double time = 0.0;
+        std::uint64_t step = 0;
+        //с этими параметрами считались шаги от этого снимка до следующего
+        double time_step = 0.0;
+        int solver_iterations = 0;
+    };
+
+    //снимки занимают не больше memory_budget байт, снимок каждые interval шагов;
+    //memory_budget = 0 выключает
+    void configure(size_t memory_budget, size_t interval);
+    bool enabled() const { return budget > 0; }
+    size_t interval() const { return every; }
+    size_t memoryBudget() const { return budget; }
+    //сколько снимков помещается в бюджет при текущем размере снимка
+    size_t capacity() const { return slots.size(); }
+
+    //нужен ли снимок перед шагом step: по интервалу или потому что шаг пойдёт
+    //с другими dt/итерациями, чем записанная история
+    bool wants(std::uint64_t step, double time_step, int solver_iterations) const;
+
+    //сохранить состояние перед шагом step; уже записанные шаги не перезаписываются,
+    //если история дальше шла с другими dt/итерациями - она отбрасывается.
+    //topology_version и params_version - при каких связях, массах и остальных параметрах
+    //он посчитан; смена любой из них сбрасывает буфер, перематывать через неё нельзя
+    void record(const std::vector<Particle>& particles, const std::vector<double>& warm, double time,
+                std::uint64_t step, double time_step, int solver_iterations,
+                size_t topology_version, size_t params_version);
+
+    //самый поздний снимок с шагом <= step для этих версий, nullptr - нет такого
+    const Slot* findAtOrBefore(std::uint64_t step, size_t topology_version, size_t params_version) const;
+
+    //частицы перенумерованы (old_of_new[новый] = старый): снимки версии from_version
+    //переставляются и считаются снимками to_version, остальные уже не нужны;
+    //порядок связей перенумерация не меняет, множители CG остаются верными
+    void permute(const std::vector<size_t>& old_of_new, size_t from_version, size_t to_version);
+
+    //забыть все снимки после шага step (история переписана правками)
+    void truncateAfter(std::uint64_t step);
+
+    void clear() { count = 0; }
+    size_t size() const { return count; }
+    std::uint64_t oldestStep() const;
+    std::uint64_t newestStep() const;
+
+private:
+    const Slot& at(size_t k) const { return slots[(head + k) % slots.size()]; }
+    Slot& at(size_t k) { return slots[(head + k) % slots.size()]; }
+    //номер (от старого) последнего снимка с шагом <= step, count - такого нет
+    size_t latestAtOrBefore(std::uint64_t step) const;
+    //новое число снимков; самые новые сохраняются
+    void resize(size_t capacity);
+
+    std::vector<Slot> slots;
+    size_t head = 0;
+    size_t count = 0;
+    size_t every = 1;
+    size_t budget = 0;
+    //байт на снимок, по которым посчитана ёмкость
+    size_t slot_bytes = 0;
+    size_t version = size_t(-1);
+    size_t params = size_t(-1);
+};
+
+#endif
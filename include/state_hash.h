@@ -0,0 +1,126 @@
+#ifndef STATE_HASH_H
+#define STATE_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//потоковый XXH64 (тот же результат, что у эталонной реализации xxHash)
+class Xxh64 {
+public:
+    explicit Xxh64(std::uint64_t seed = 0) { reset(seed); }
+
+    void reset(std::uint64_t seed = 0) {
+        v[0] = seed + P1 + P2;
+        v[1] = seed + P2;
+        v[2] = seed;
+        v[3] = seed - P1;
+        this->seed = seed;
+        total = 0;
+        buffered = 0;
+    }
+
+    void update(const void* data, size_t len) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        total += len;
+
+        if (buffered + len < 32) {
+            std::memcpy(buffer + buffered, p, len);
+            buffered += len;
+            return;
+        }
+        if (buffered > 0) {
+            size_t fill = 32 - buffered;
+            std::memcpy(buffer + buffered, p, fill);
+            stripe(buffer);
+            p += fill;
+            len -= fill;
+            buffered = 0;
+        }
+        while (len >= 32) {
+            stripe(p);
+            p += 32;
+            len -= 32;
+        }
+        std::memcpy(buffer, p, len);
+        buffered = len;
+    }
+
+    std::uint64_t digest() const {
+        std::uint64_t h;
+        if (total >= 32) {
+            h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+            for (int i = 0; i < 4; i++) {
+                h ^= round(0, v[i]);
+                h = h * P1 + P4;
+            }
+        } else {
+            h = seed + P5;
+        }
+        h += total;
+
+        const unsigned char* p = buffer;
+        size_t len = buffered;
+        while (len >= 8) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * P1 + P4;
+            p += 8;
+            len -= 8;
+        }
+        if (len >= 4) {
+            h ^= std::uint64_t(read32(p)) * P1;
+            h = rotl(h, 23) * P2 + P3;
+            p += 4;
+            len -= 4;
+        }
+        while (len > 0) {
+            h ^= (*p) * P5;
+            h = rotl(h, 11) * P1;
+            p++;
+            len--;
+        }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static constexpr std::uint64_t P1 = 11400714785074694791ULL;
+    static constexpr std::uint64_t P2 = 14029467366897019727ULL;
+    static constexpr std::uint64_t P3 = 1609587929392839161ULL;
+    static constexpr std::uint64_t P4 = 9650029242287828579ULL;
+    static constexpr std::uint64_t P5 = 2870177450012600261ULL;
+
+    static std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static std::uint64_t round(std::uint64_t acc, std::uint64_t input) {
+        acc += input * P2;
+        acc = rotl(acc, 31);
+        return acc * P1;
+    }
+    static std::uint64_t read64(const unsigned char* p) { std::uint64_t x; std::memcpy(&x, p, 8); return x; }
+    static std::uint32_t read32(const unsigned char* p) { std::uint32_t x; std::memcpy(&x, p, 4); return x; }
+
+    void stripe(const unsigned char* p) {
+        for (int i = 0; i < 4; i++) {
+            v[i] = round(v[i], read64(p + 8 * i));
+        }
+    }
+
+    std::uint64_t v[4];
+    std::uint64_t seed;
+    std::uint64_t total;
+    unsigned char buffer[32];
+    size_t buffered;
+};
+
+inline std::uint64_t xxhash64(const void* data, size_t len, std::uint64_t seed = 0) {
+    Xxh64 h(seed);
+    h.update(data, len);
+    return h.digest();
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cstdint>
+#include "headless.h"
+
+//перебор начальных условий двойного маятника по сетке параметров.
+//Сетка режется на шарды подряд идущих точек; координатор запускает по процессу
+//на шард (не больше --workers сразу), каждый пишет в свою область общего файла
+//результатов через mmap и после записи отмечает шард готовым. Повторный запуск
+//с тем же файлом пропускает готовые шарды - так досчитывается прерванный перебор
+
+//оси сетки: углы звеньев от вертикали (рад), масса и длина второго звена, затухание
+enum SweepParam { SWEEP_THETA1, SWEEP_THETA2, SWEEP_MASS2, SWEEP_LENGTH2, SWEEP_DAMPING, SWEEP_PARAM_COUNT };
+
+//count значений от lo до hi включительно; при count == 1 - только lo
+struct SweepAxis {
+    double lo = 0.0;
+    double hi = 0.0;
+    std::uint32_t count = 1;
+    std::uint32_t reserved = 0;
+
+    double value(std::uint64_t i) const;
+};
+
+//всё, что определяет перебор; хранится в заголовке файла результатов
+struct SweepSpec {
+    SweepAxis axes[SWEEP_PARAM_COUNT];
+    double sim_time = 10.0;
+    double dt = 0.004;
+    std::int32_t iterations = 20;
+    std::uint32_t shard_size = 64;
+
+    std::uint64_t pointCount() const;
+    std::uint64_t shardCount() const;
+    //параметры точки: индекс разбирается по осям, THETA1 меняется быстрее всех
+    void point(std::uint64_t index, double params[SWEEP_PARAM_COUNT]) const;
+};
+
+bool operator==(const SweepSpec& a, const SweepSpec& b);
+
+//результат одной точки (первое звено - длина 100, масса 1)
+struct SweepRecord {
+    double params[SWEEP_PARAM_COUNT];
+    //время первого переворота второго звена через верх, NaN - не перевернулось
+    double flip_time;
+    //углы звеньев в конце, (-pi, pi]
+    double theta1;
+    double theta2;
+    //изменение энергии к концу, доля (m1 + m2) g (l1 + l2)
+    double energy_drift;
+};
+
+SweepRecord run_sweep_point(const SweepSpec& spec, std::uint64_t index);
+
+//--sweep <файл> [--theta1 lo hi n] [--theta2 ...] [--mass2 ...] [--length2 ...] [--damping ...]
+//        [--shard-size n] [--workers n] [--sim-time s] [--dt dt] [--iterations n] [--csv файл]
+//ось одним числом - одно значение. Существующий файл того же перебора досчитывается
+int sweep_mode(const CliArgs& args, const char* self_path);
+
+//--sweep-worker <файл> --shard k: посчитать один шард (так его запускает координатор)
+int sweep_worker_mode(const CliArgs& args);
+
+#endif
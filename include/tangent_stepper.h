@@ -0,0 +1,243 @@
+#ifndef TANGENT_STEPPER_H
+#define TANGENT_STEPPER_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "physics_engine.h"
+#include "dual.h"
+#include "trace.h"
+
+//шаг движка в прямом режиме дифференцирования: вместе с состоянием за тот же проход
+//переносятся K касательных (производных состояния по K направлениям возмущения).
+//Значения считаются теми же ядрами и в том же порядке, что и в PhysicsEngine::step(),
+//так что шаг с касательными даёт побитово то же состояние.
+//После n шагов касательная k - это J v_k, J - якобиан отображения n шагов.
+//Поддерживается решатель Гаусса-Зейделя без полей сил и препятствий
+template <size_t K>
+class TangentStepper {
+public:
+    explicit TangentStepper(PhysicsEngine& eng) : engine(eng) { reset(); }
+
+    //обнулить касательные и накопленное; вызывать после любой смены топологии
+    void reset();
+
+    //направление k: возмущение позиций и скоростей (по числу частиц; у закреплённых - 0)
+    void setTangent(size_t k, const std::vector<Vec2d>& dpos, const std::vector<Vec2d>& dvel);
+    void getTangent(size_t k, std::vector<Vec2d>& dpos, std::vector<Vec2d>& dvel) const;
+    //случайные ортонормированные направления - начало оценки показателей Ляпунова
+    void randomizeTangents(std::uint64_t seed);
+    double tangentNorm(size_t k) const;
+
+    void step();
+
+    //каждые n шагов касательные ортонормируются (Грам-Шмидт), логарифмы растяжений
+    //копятся; без этого они растут экспоненциально и теряют точность (0 - только вручную)
+    void setRenormalizeInterval(size_t n) { renormalize_every = n; }
+    void renormalize() { orthonormalize(true); }
+    //оценки K старших показателей Ляпунова, 1/с (по времени до последней нормировки)
+    std::array<double, K> lyapunovExponents() const;
+    double largestLyapunov() const { return lyapunovExponents()[0]; }
+
+private:
+    double dotTangents(size_t a, size_t b) const;
+    void orthonormalize(bool accumulate);
+
+    PhysicsEngine& engine;
+    std::vector<DualVec2<K>> pos, vel, pred;
+    size_t version = size_t(-1);
+
+    size_t renormalize_every = 10;
+    size_t since_renormalize = 0;
+    double elapsed = 0.0;
+    double measured = 0.0;
+    std::array<double, K> log_growth{};
+};
+
+template <size_t K>
+void TangentStepper<K>::reset() {
+    //правки и перенумерация - сейчас, а не внутри шага: индексы касательных не должны уехать
+    engine.commitEdits();
+    if (engine.auto_reorder != ReorderMethod::None && engine.reorder_version != engine.topology_version) {
+        engine.reorderForLocality(engine.auto_reorder);
+        engine.reorder_version = engine.topology_version;
+    }
+    size_t n = engine.particles.size();
+    pos.assign(n, {});
+    vel.assign(n, {});
+    pred.assign(n, {});
+    version = engine.topology_version;
+    since_renormalize = 0;
+    elapsed = 0.0;
+    measured = 0.0;
+    log_growth.fill(0.0);
+}
+
+template <size_t K>
+void TangentStepper<K>::setTangent(size_t k, const std::vector<Vec2d>& dpos, const std::vector<Vec2d>& dvel) {
+    if (k >= K) throw std::out_of_range("Tangent index out of range");
+    for (size_t i = 0; i < pos.size(); i++) {
+        bool moving = !engine.particles[i].fixed;
+        Vec2d dp = moving && i < dpos.size() ? dpos[i] : Vec2d{0, 0};
+        Vec2d dv = moving && i < dvel.size() ? dvel[i] : Vec2d{0, 0};
+        pos[i].x.d[k] = dp.x;
+        pos[i].y.d[k] = dp.y;
+        vel[i].x.d[k] = dv.x;
+        vel[i].y.d[k] = dv.y;
+    }
+}
+
+template <size_t K>
+void TangentStepper<K>::getTangent(size_t k, std::vector<Vec2d>& dpos, std::vector<Vec2d>& dvel) const {
+    if (k >= K) throw std::out_of_range("Tangent index out of range");
+    dpos.resize(pos.size());
+    dvel.resize(pos.size());
+    for (size_t i = 0; i < pos.size(); i++) {
+        dpos[i] = {pos[i].x.d[k], pos[i].y.d[k]};
+        dvel[i] = {vel[i].x.d[k], vel[i].y.d[k]};
+    }
+}
+
+template <size_t K>
+void TangentStepper<K>::randomizeTangents(std::uint64_t seed) {
+    //splitmix64: воспроизводимо и без <random>
+    auto next = [&seed]() {
+        std::uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        return double(z >> 11) / double(1ull << 53) * 2.0 - 1.0;
+    };
+    for (size_t i = 0; i < pos.size(); i++) {
+        bool moving = !engine.particles[i].fixed;
+        for (size_t k = 0; k < K; k++) {
+            pos[i].x.d[k] = moving ? next() : 0.0;
+            pos[i].y.d[k] = moving ? next() : 0.0;
+            vel[i].x.d[k] = moving ? next() : 0.0;
+            vel[i].y.d[k] = moving ? next() : 0.0;
+        }
+    }
+    orthonormalize(false);
+}
+
+template <size_t K>
+double TangentStepper<K>::dotTangents(size_t a, size_t b) const {
+    double s = 0.0;
+    for (size_t i = 0; i < pos.size(); i++) {
+        s += pos[i].x.d[a] * pos[i].x.d[b] + pos[i].y.d[a] * pos[i].y.d[b] +
+             vel[i].x.d[a] * vel[i].x.d[b] + vel[i].y.d[a] * vel[i].y.d[b];
+    }
+    return s;
+}
+
+template <size_t K>
+double TangentStepper<K>::tangentNorm(size_t k) const {
+    return std::sqrt(dotTangents(k, k));
+}
+
+template <size_t K>
+void TangentStepper<K>::orthonormalize(bool accumulate) {
+    for (size_t k = 0; k < K; k++) {
+        for (size_t j = 0; j < k; j++) {
+            double proj = dotTangents(k, j);
+            for (size_t i = 0; i < pos.size(); i++) {
+                pos[i].x.d[k] -= proj * pos[i].x.d[j];
+                pos[i].y.d[k] -= proj * pos[i].y.d[j];
+                vel[i].x.d[k] -= proj * vel[i].x.d[j];
+                vel[i].y.d[k] -= proj * vel[i].y.d[j];
+            }
+        }
+        double norm = tangentNorm(k);
+        if (norm < 1e-300) continue;
+        if (accumulate) log_growth[k] += std::log(norm);
+        for (size_t i = 0; i < pos.size(); i++) {
+            pos[i].x.d[k] /= norm;
+            pos[i].y.d[k] /= norm;
+            vel[i].x.d[k] /= norm;
+            vel[i].y.d[k] /= norm;
+        }
+    }
+    if (accumulate) measured = elapsed;
+    since_renormalize = 0;
+}
+
+template <size_t K>
+std::array<double, K> TangentStepper<K>::lyapunovExponents() const {
+    std::array<double, K> out{};
+    if (measured <= 0.0) return out;
+    for (size_t k = 0; k < K; k++) {
+        out[k] = log_growth[k] / measured;
+    }
+    return out;
+}
+
+//повторяет PhysicsEngine::step() по фазам; значения идут через те же операции
+template <size_t K>
+void TangentStepper<K>::step() {
+    PhysicsEngine& e = engine;
+    if (e.topology_version != version || e.hasPendingEdits()) {
+        throw std::logic_error("Topology changed since TangentStepper::reset()");
+    }
+    if (e.solver_mode != SolverMode::GaussSeidel || !e.force_fields.empty() || !e.colliders.empty()) {
+        throw std::logic_error("Tangent stepping needs the Gauss-Seidel solver without fields and colliders");
+    }
+    PENDULUM_TRACE_ZONE("TangentStepper::step");
+    e.beginStep();
+    //автоматическая перенумерация перепутала бы строки касательных векторов
+    if (e.topology_version != version) {
+        throw std::logic_error("Topology changed since TangentStepper::reset()");
+    }
+
+    std::vector<Particle>& particles = e.particles;
+    size_t n = particles.size();
+    double dt = e.time_step;
+    for (size_t i = 0; i < n; i++) {
+        const Particle& p = particles[i];
+        pos[i].x.v = p.position.x;
+        pos[i].y.v = p.position.y;
+        vel[i].x.v = p.velocity.x;
+        vel[i].y.v = p.velocity.y;
+    }
+
+    //шаги 1-2: скорости и предсказание
+    Vec2d gravity_step = e.gravity * dt;
+    for (size_t i = 0; i < n; i++) {
+        if (!particles[i].fixed) {
+            vel[i].x = vel[i].x + gravity_step.x;
+            vel[i].y = vel[i].y + gravity_step.y;
+            vel[i].x *= (1.0 - e.damping);
+            vel[i].y *= (1.0 - e.damping);
+        }
+        pred[i] = pos[i] + vel[i] * dt;
+    }
+
+    //шаг 3: острова по порядку (в движке они независимы, порядок не влияет на результат)
+    e.prepareBatches();
+    auto at = [this](size_t i) -> DualVec2<K>& { return pred[i]; };
+    for (size_t island = 0; island < e.batches.islandCount(); island++) {
+        e.batches.solveIslandAt(island, at, e.solver_iterations);
+    }
+
+    //шаг 4
+    for (size_t i = 0; i < n; i++) {
+        Particle& p = particles[i];
+        p.predicted_position = {pred[i].x.v, pred[i].y.v};
+        if (!p.fixed) {
+            vel[i] = (pred[i] - pos[i]) / dt;
+            pos[i] = pred[i];
+            p.velocity = {vel[i].x.v, vel[i].y.v};
+            p.position = p.predicted_position;
+        }
+    }
+
+    e.endStep();
+
+    elapsed += dt;
+    if (renormalize_every > 0 && ++since_renormalize >= renormalize_every) {
+        orthonormalize(true);
+    }
+}
+
+#endif
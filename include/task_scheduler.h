@@ -0,0 +1,105 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//пул потоков с воровством задач: у каждого воркера своя очередь,
+//свои задачи берутся с конца, чужие воруются с начала
+class TaskScheduler {
+public:
+    using Task = std::function<void()>;
+
+    //thread_count - сколько потоков считают вместе с вызывающим (0 - по числу ядер);
+    //pin_threads закрепляет воркеров за ядрами 1..n-1, сам вызывающий поток не трогается
+    explicit TaskScheduler(unsigned thread_count = 0, bool pin_threads = false);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    //поставить задачу в очередь (из воркера - в свою, иначе - в общую)
+    void submit(Task task);
+
+    //выполнить одну задачу из очередей, false - если задач нет
+    bool runOne();
+
+    //fn(b, e) вызывается для кусков [b, e) длиной не больше grain,
+    //вызывающий поток тоже работает; grain = 0 - подобрать автоматически
+    void parallel_for(size_t begin, size_t end, size_t grain,
+                      const std::function<void(size_t, size_t)>& fn);
+
+    //закрепить текущий поток за ядром 0 (по желанию вызывающего, навсегда)
+    void pinCallingThread();
+
+    //сколько воркеры крутятся до засыпания после последней задачи; чтобы между
+    //кадрами они не засыпали, время должно быть не меньше периода шага
+    void setSpinTime(std::chrono::microseconds spin) { spin_time_us.store(spin.count()); }
+
+    unsigned workerCount() const { return static_cast<unsigned>(workers.size()); }
+    unsigned concurrency() const { return workerCount() + 1; }
+    bool pinned() const { return pin; }
+
+    //индекс воркера текущего потока в этом пуле, -1 если поток не наш
+    int currentWorker() const;
+
+    //по умолчанию - чуть больше кадра при 60 Гц
+    static constexpr long long DEFAULT_SPIN_US = 20000;
+
+private:
+    struct alignas(64) WorkQueue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(unsigned idx);
+    bool popLocal(unsigned idx, Task& out);
+    bool steal(unsigned thief, Task& out);
+    void wakeOne();
+
+    std::vector<std::thread> workers;
+    //очереди воркеров + последняя общая для внешних потоков
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+
+    std::atomic<size_t> queued{0};
+    std::atomic<unsigned> sleepers{0};
+    std::atomic<long long> spin_time_us{DEFAULT_SPIN_US};
+    std::atomic<bool> stopping{false};
+    std::mutex park_lock;
+    std::condition_variable park_cv;
+    bool pin = false;
+};
+
+//группа задач, которую можно дождаться; ожидающий поток сам помогает выполнять задачи
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskScheduler& sched) : scheduler(sched) {}
+    ~TaskGroup() { wait_noexcept(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(TaskScheduler::Task task);
+
+    //ждём все задачи группы, первое пойманное исключение пробрасывается
+    void wait();
+
+private:
+    void wait_noexcept();
+
+    TaskScheduler& scheduler;
+    std::atomic<size_t> pending{0};
+    std::mutex error_lock;
+    std::exception_ptr error;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef TOPOLOGY_EDITS_H
+#define TOPOLOGY_EDITS_H
+
+#include <cstddef>
+#include <vector>
+#include "Vec2D.h"
+
+//правки топологии, собранные за кадр; движок применяет их одной пачкой
+//между шагами (PhysicsEngine::applyEdits), индексы - на момент до пачки
+class TopologyEdits {
+public:
+    //индекс ещё не созданной частицы: годится для связей и правок в этой же пачке
+    static bool isPending(size_t idx) { return (idx & PENDING_BIT) != 0; }
+
+    size_t addParticle(const Vec2d& position, double mass = 1.0, const Vec2d& velocity = {0, 0},
+                       bool fixed = false);
+    void removeParticle(size_t idx);
+    void setMass(size_t idx, double mass);
+    void setFixed(size_t idx, bool fixed);
+    void setVelocity(size_t idx, const Vec2d& velocity);
+
+    //length < 0 - расстояние между частицами в момент применения
+    void addConstraint(size_t idx1, size_t idx2, double length = -1.0, double stiffness = 1.0,
+                       bool rope = false);
+    void removeConstraint(size_t idx);
+    void retuneConstraint(size_t idx, double length, double stiffness);
+
+    bool empty() const {
+        return new_particles.empty() && removed_particles.empty() && particle_edits.empty() &&
+               new_constraints.empty() && removed_constraints.empty() && constraint_edits.empty();
+    }
+    void clear();
+
+private:
+    friend class PhysicsEngine;
+
+    static constexpr size_t PENDING_BIT = size_t(1) << (sizeof(size_t) * 8 - 1);
+
+    struct NewParticle { Vec2d position; double mass; Vec2d velocity; bool fixed; };
+    enum class Field { Mass, Fixed, Velocity };
+    struct ParticleEdit { size_t idx; Field field; double value; Vec2d velocity; };
+    struct NewConstraint { size_t idx1, idx2; double length, stiffness; bool rope; };
+    struct ConstraintEdit { size_t idx; double length, stiffness; };
+
+    std::vector<NewParticle> new_particles;
+    std::vector<size_t> removed_particles;
+    std::vector<ParticleEdit> particle_edits;
+    std::vector<NewConstraint> new_constraints;
+    std::vector<size_t> removed_constraints;
+    std::vector<ConstraintEdit> constraint_edits;
+};
+
+#endif
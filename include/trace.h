@@ -0,0 +1,50 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+//запись зон кадра в буфер своего потока (без блокировок) и выгрузка
+//в Chrome/Perfetto trace-event JSON; выключенная зона стоит одну проверку флага
+namespace Trace {
+    void setEnabled(bool on);
+    bool enabled();
+
+    //имя потока в трассе (physics, worker 3, ...)
+    void setThreadName(const std::string& name);
+
+    //name должен жить всю программу (строковый литерал)
+    void record(const char* name, std::uint64_t start_ns, std::uint64_t end_ns);
+
+    //записать всё накопленное; false - не удалось открыть файл
+    bool writeJson(const std::string& path);
+    //сколько событий сейчас лежит в буферах
+    size_t eventCount();
+    void clear();
+
+    inline std::uint64_t nowNs() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    class Zone {
+    public:
+        explicit Zone(const char* zone_name) : name(zone_name), start(enabled() ? nowNs() : 0) {}
+        ~Zone() {
+            if (start != 0) record(name, start, nowNs());
+        }
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char* name;
+        std::uint64_t start;
+    };
+}
+
+#define PENDULUM_TRACE_CONCAT_INNER(a, b) a##b
+#define PENDULUM_TRACE_CONCAT(a, b) PENDULUM_TRACE_CONCAT_INNER(a, b)
+#define PENDULUM_TRACE_ZONE(name) Trace::Zone PENDULUM_TRACE_CONCAT(trace_zone_, __LINE__)(name)
+
+#endif
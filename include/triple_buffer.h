@@ -0,0 +1,41 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+//тройной буфер без блокировок: один поток пишет, другой читает последний
+//законченный кадр; писатель и читатель никогда не ждут друг друга
+template <class T>
+class TripleBuffer {
+public:
+    //буфер, в который сейчас пишет писатель
+    T& writeBuffer() { return buffers[back]; }
+
+    //отдать записанный буфер читателю, взамен забрать свободный
+    void publish() {
+        back = middle.exchange(static_cast<std::uint8_t>(back | DIRTY), std::memory_order_acq_rel) & INDEX;
+    }
+
+    //есть ли кадр новее того, что читатель уже видел
+    bool hasNew() const { return (middle.load(std::memory_order_acquire) & DIRTY) != 0; }
+
+    //последний опубликованный кадр (только из потока читателя)
+    const T& read() {
+        if (hasNew()) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        }
+        return buffers[front];
+    }
+
+private:
+    static constexpr std::uint8_t INDEX = 0x3;
+    static constexpr std::uint8_t DIRTY = 0x4;
+
+    T buffers[3];
+    std::uint8_t back = 0;
+    std::atomic<std::uint8_t> middle{1};
+    std::uint8_t front = 2;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef UI_RESOURCES_H
+#define UI_RESOURCES_H
+
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//общие ресурсы интерфейса. Шрифт читается и разбирается на фоновом потоке, пока
+//идут первые кадры; поток отрисовки забирает его в poll() и запекает глифы размеров
+//из visual_config.h по одному размеру за кадр. Путь к шрифту ищется по списку:
+//сначала добавленные addFontPath, затем $PENDULUM_FONT, затем системные шрифты
+class UiResources {
+public:
+    UiResources();
+    ~UiResources();
+
+    UiResources(const UiResources&) = delete;
+    UiResources& operator=(const UiResources&) = delete;
+
+    //файл шрифта или папка с .ttf/.otf; проверяется раньше стандартных путей
+    //(только до startLoading)
+    void addFontPath(const std::string& path);
+    const std::vector<std::string>& fontPaths() const { return paths; }
+
+    //начать загрузку в фоне; повторный вызов ничего не делает
+    void startLoading();
+    //раз в кадр из потока отрисовки: забрать готовый шрифт, запечь следующий размер
+    void poll();
+    //дождаться шрифта - когда он нужен раньше, чем догрузился
+    void waitLoaded();
+
+    //шрифт забран из фонового потока (найден или нет)
+    bool loaded() const { return handed_over; }
+    bool hasFont() const { return font_ok; }
+    const std::string& fontFile() const { return font_file; }
+    //пустой шрифт, пока не loaded(); тексты с ним не рисуются
+    const sf::Font& font() const { return ui_font; }
+
+    //новый текст на общем шрифте (общие только шрифт и его глифы, тексты не
+    //кэшируются - владелец меняет их строку); до загрузки шрифта дожидается его
+    std::unique_ptr<sf::Text> makeText(const std::string& str, unsigned size,
+                                       sf::Color color = sf::Color::White);
+
+private:
+    void load();
+    void handOver();
+
+    std::vector<std::string> paths;
+    size_t user_paths = 0;
+    std::thread worker;
+    std::atomic<bool> worker_done{false};
+    bool started = false;
+    bool handed_over = false;
+
+    //данные файла живут, пока жив шрифт: FreeType читает их по мере надобности
+    std::vector<char> font_data;
+    sf::Font ui_font;
+    std::string font_file;
+    bool font_ok = false;
+    size_t baked_sizes = 0;
+};
+
+#endif
@@ -24,6 +24,8 @@ namespace Config {
     constexpr int LABEL_FONT_SIZE = 20;
     constexpr int VALUE_FONT_SIZE = 20;
     constexpr int BUTTON_FONT_SIZE = 16;
+    //размеры, для которых глифы запекаются заранее (все размеры выше)
+    constexpr unsigned PREBAKED_FONT_SIZES[] = {TITLE_FONT_SIZE, LABEL_FONT_SIZE, VALUE_FONT_SIZE, BUTTON_FONT_SIZE};
     
     //позиционирование (относительные смещения)
     constexpr int TITLE_X = 30;
@@ -0,0 +1,357 @@
+#include "../include/benchmark.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace {
+    const double PI = 3.14159265358979323846;
+    const double GRAVITY = 300.0;
+
+    const char* solver_name(SolverMode mode) {
+        switch (mode) {
+        case SolverMode::Jacobi: return "jacobi";
+        case SolverMode::ConjugateGradient: return "cg";
+        default: return "gs";
+        }
+    }
+
+    //имя решателя из --solver-list; false - такого нет
+    bool parse_solver(const std::string& name, SolverMode& mode) {
+        if (name == "gs") mode = SolverMode::GaussSeidel;
+        else if (name == "jacobi") mode = SolverMode::Jacobi;
+        else if (name == "cg") mode = SolverMode::ConjugateGradient;
+        else return false;
+        return true;
+    }
+
+    PhysicsEngine make_engine(const BenchConfig& cfg, unsigned threads) {
+        PhysicsEngine engine(Vec2d(0, GRAVITY), cfg.dt, cfg.iterations, cfg.damping);
+        engine.setThreadCount(threads);
+        engine.setSolverMode(cfg.solver);
+        return engine;
+    }
+
+    long long step_count(const PhysicsEngine& engine, double sim_time) {
+        return static_cast<long long>(std::ceil(sim_time / engine.getTimeStep()));
+    }
+
+    //цена - отдельный прогон той же сцены без замеров: часы на каждом шаге
+    //стоили бы дороже самого шага маленькой сцены
+    template <class Setup>
+    double wall_per_sim_second(const BenchConfig& cfg, unsigned threads, double sim_time, Setup&& setup) {
+        PhysicsEngine engine = make_engine(cfg, threads);
+        setup(engine);
+        long long steps = step_count(engine, sim_time);
+        auto start = std::chrono::steady_clock::now();
+        for (long long i = 0; i < steps; i++) {
+            engine.step();
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / sim_time;
+    }
+
+    template <class OnStep>
+    void run(PhysicsEngine& engine, double sim_time, OnStep&& on_step) {
+        long long steps = step_count(engine, sim_time);
+        for (long long i = 0; i < steps; i++) {
+            engine.step();
+            on_step();
+        }
+    }
+
+    const double PERIOD_LENGTH = 100.0;
+    const double PERIOD_THETA0 = 0.05;
+
+    size_t setup_period(PhysicsEngine& engine) {
+        Vec2d pivot{0.0, 0.0};
+        size_t bob = engine.createSimplePendulum(pivot, PERIOD_LENGTH, 1.0);
+        Particle& p = engine.getParticle(bob);
+        p.position = pivot + Vec2d{PERIOD_LENGTH * std::sin(PERIOD_THETA0), PERIOD_LENGTH * std::cos(PERIOD_THETA0)};
+        p.predicted_position = p.position;
+        return bob;
+    }
+
+    const double DOUBLE_L1 = 100.0, DOUBLE_L2 = 100.0, DOUBLE_M1 = 1.0, DOUBLE_M2 = 1.0;
+
+    void setup_energy(PhysicsEngine& engine) {
+        engine.createDoublePendulum(Vec2d{0.0, 0.0}, DOUBLE_L1, DOUBLE_L2, DOUBLE_M1, DOUBLE_M2);
+    }
+
+    //цепь стартует горизонтально и падает - звенья растягиваются сильнее всего в рывке
+    SceneRange setup_stretch(PhysicsEngine& engine) {
+        return engine.createChain(Vec2d{0.0, 0.0}, 20, 10.0, 1.0, Vec2d{1.0, 0.0});
+    }
+
+    //период по восходящим переходам через вертикаль (с линейной интерполяцией)
+    double period_error(PhysicsEngine& engine, double sim_time) {
+        size_t bob = setup_period(engine);
+        std::vector<double> crossings;
+        double prev_x = engine.getParticle(bob).position.x;
+        double prev_t = 0.0;
+        run(engine, sim_time, [&] {
+            double x = engine.getParticle(bob).position.x;
+            double t = engine.getTime();
+            if (prev_x < 0.0 && x >= 0.0) {
+                crossings.push_back(prev_t + (t - prev_t) * (-prev_x) / (x - prev_x));
+            }
+            prev_x = x;
+            prev_t = t;
+        });
+        if (crossings.size() < 2) return std::numeric_limits<double>::quiet_NaN();
+
+        double measured = (crossings.back() - crossings.front()) / double(crossings.size() - 1);
+        //поправка на конечную амплитуду: T = T0 (1 + theta0^2 / 16)
+        double reference = 2.0 * PI * std::sqrt(PERIOD_LENGTH / GRAVITY) *
+                           (1.0 + PERIOD_THETA0 * PERIOD_THETA0 / 16.0);
+        return std::abs(measured - reference) / reference;
+    }
+
+    double energy(const PhysicsEngine& engine) {
+        double e = 0.0;
+        for (size_t i = 0; i < engine.getParticleCount(); i++) {
+            const Particle& p = engine.getParticle(i);
+            if (p.inv_mass <= 0.0) continue;
+            double m = 1.0 / p.inv_mass;
+            //ось y направлена вниз, туда же тяжесть
+            e += 0.5 * m * dot(p.velocity, p.velocity) - m * GRAVITY * p.position.y;
+        }
+        return e;
+    }
+
+    //наклон E(t) методом наименьших квадратов: колебания энергии внутри шага не мешают
+    double energy_drift(PhysicsEngine& engine, double sim_time) {
+        setup_energy(engine);
+        double n = 0, st = 0, se = 0, stt = 0, ste = 0;
+        auto sample = [&] {
+            double t = engine.getTime();
+            double e = energy(engine);
+            n += 1;
+            st += t;
+            se += e;
+            stt += t * t;
+            ste += t * e;
+        };
+        sample();
+        run(engine, sim_time, sample);
+
+        double denom = n * stt - st * st;
+        if (denom <= 0.0) return std::numeric_limits<double>::quiet_NaN();
+        double slope = (n * ste - st * se) / denom;
+        return std::abs(slope) / ((DOUBLE_M1 + DOUBLE_M2) * GRAVITY * (DOUBLE_L1 + DOUBLE_L2));
+    }
+
+    double max_stretch(PhysicsEngine& engine, double sim_time) {
+        SceneRange chain = setup_stretch(engine);
+        double worst = 0.0;
+        run(engine, sim_time, [&] {
+            for (size_t k = 0; k < chain.constraint_count; k++) {
+                const Constraint& c = engine.getConstraint(chain.first_constraint + k);
+                double len = leight(engine.getParticle(c.particle2_idx).position -
+                                    engine.getParticle(c.particle1_idx).position);
+                worst = std::max(worst, (len - c.target_length) / c.target_length);
+            }
+        });
+        return worst;
+    }
+
+    void write_number(std::ostream& out, double v) {
+        if (std::isfinite(v)) {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.6g", v);
+            out << buf;
+        } else {
+            out << "null";
+        }
+    }
+
+    std::vector<double> number_list(const CliArgs& args, const std::string& key, std::vector<double> def) {
+        std::vector<std::string> raw = args.values(key);
+        if (raw.empty()) return def;
+        std::vector<double> out;
+        for (const auto& s : raw) {
+            try {
+                out.push_back(std::stod(s));
+            } catch (...) {
+                std::cerr << "Ignoring bad value " << s << " for " << key << std::endl;
+            }
+        }
+        return out;
+    }
+}
+
+std::vector<BenchResult> run_benchmarks(const std::vector<std::string>& scenarios,
+                                        const std::vector<BenchConfig>& configs, double sim_time,
+                                        unsigned threads) {
+    std::vector<BenchResult> results;
+    results.reserve(scenarios.size() * configs.size());
+    for (const auto& name : scenarios) {
+        for (const auto& cfg : configs) {
+            PhysicsEngine engine = make_engine(cfg, threads);
+            BenchResult row;
+            row.scenario = name;
+            row.config = cfg;
+            if (name == "period") {
+                row.metric = "period_rel_error";
+                row.error = period_error(engine, sim_time);
+                row.wall_per_sim_second = wall_per_sim_second(cfg, threads, sim_time, setup_period);
+            } else if (name == "energy") {
+                row.metric = "energy_drift_per_s";
+                row.error = energy_drift(engine, sim_time);
+                row.wall_per_sim_second = wall_per_sim_second(cfg, threads, sim_time, setup_energy);
+            } else if (name == "stretch") {
+                row.metric = "max_stretch";
+                row.error = max_stretch(engine, sim_time);
+                row.wall_per_sim_second = wall_per_sim_second(cfg, threads, sim_time, setup_stretch);
+            } else {
+                throw std::invalid_argument("Unknown benchmark scenario " + name);
+            }
+            results.push_back(row);
+        }
+    }
+    mark_pareto(results);
+    return results;
+}
+
+void mark_pareto(std::vector<BenchResult>& results) {
+    for (auto& r : results) {
+        r.pareto = std::isfinite(r.error);
+        for (const auto& other : results) {
+            if (!r.pareto) break;
+            if (&other == &r || other.scenario != r.scenario || !std::isfinite(other.error)) continue;
+            bool no_worse = other.error <= r.error && other.wall_per_sim_second <= r.wall_per_sim_second;
+            bool better = other.error < r.error || other.wall_per_sim_second < r.wall_per_sim_second;
+            if (no_worse && better) r.pareto = false;
+        }
+    }
+}
+
+bool write_bench_csv(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "scenario,metric,solver,dt,iterations,damping,error,wall_per_sim_second,pareto\n";
+    for (const auto& r : results) {
+        out << r.scenario << "," << r.metric << "," << solver_name(r.config.solver) << ",";
+        write_number(out, r.config.dt);
+        out << "," << r.config.iterations << ",";
+        write_number(out, r.config.damping);
+        out << ",";
+        if (std::isfinite(r.error)) write_number(out, r.error);
+        out << ",";
+        write_number(out, r.wall_per_sim_second);
+        out << "," << (r.pareto ? 1 : 0) << "\n";
+    }
+    return bool(out);
+}
+
+bool write_bench_json(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "{\"results\":[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << "  {\"scenario\":\"" << r.scenario << "\",\"metric\":\"" << r.metric
+            << "\",\"solver\":\"" << solver_name(r.config.solver) << "\",\"dt\":";
+        write_number(out, r.config.dt);
+        out << ",\"iterations\":" << r.config.iterations << ",\"damping\":";
+        write_number(out, r.config.damping);
+        out << ",\"error\":";
+        write_number(out, r.error);
+        out << ",\"wall_per_sim_second\":";
+        write_number(out, r.wall_per_sim_second);
+        out << ",\"pareto\":" << (r.pareto ? "true" : "false") << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+    return bool(out);
+}
+
+int bench_mode(const CliArgs& args) {
+    std::vector<std::string> scenarios = args.values("--bench");
+    if (scenarios.empty()) scenarios = {"period", "energy", "stretch"};
+
+    std::vector<double> dts = number_list(args, "--dt-list", {0.016, 0.008, 0.004, 0.002});
+    std::vector<double> iterations = number_list(args, "--iter-list", {1, 5, 10, 20});
+    std::vector<double> dampings = number_list(args, "--damping-list", {0.0});
+    std::vector<std::string> solver_names = args.values("--solver-list");
+    if (solver_names.empty()) solver_names = {"gs", "jacobi"};
+    //опечатка не должна молча превращаться в Гаусса-Зейделя
+    std::vector<SolverMode> solvers;
+    for (const auto& name : solver_names) {
+        SolverMode mode;
+        if (!parse_solver(name, mode)) {
+            std::cerr << "Unknown solver " << name << " (expected gs, jacobi or cg)" << std::endl;
+            return 2;
+        }
+        solvers.push_back(mode);
+    }
+
+    std::vector<BenchConfig> configs;
+    for (SolverMode solver : solvers) {
+        for (double dt : dts) {
+            for (double it : iterations) {
+                for (double damping : dampings) {
+                    if (dt <= 0.0 || it < 1) continue;
+                    BenchConfig cfg;
+                    cfg.solver = solver;
+                    cfg.dt = dt;
+                    cfg.iterations = static_cast<int>(it);
+                    cfg.damping = damping;
+                    configs.push_back(cfg);
+                }
+            }
+        }
+    }
+
+    double sim_time = args.getDouble("--sim-time", 20.0);
+    unsigned threads = static_cast<unsigned>(args.getInt("--threads", 1));
+    std::vector<BenchResult> results;
+    try {
+        results = run_benchmarks(scenarios, configs, sim_time, threads);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    std::string csv = args.get("--csv");
+    std::string json = args.get("--json");
+    if (!csv.empty() && !write_bench_csv(csv, results)) {
+        std::cerr << "Cannot write " << csv << std::endl;
+        return 2;
+    }
+    if (!json.empty() && !write_bench_json(json, results)) {
+        std::cerr << "Cannot write " << json << std::endl;
+        return 2;
+    }
+
+    //в консоль - только фронт Парето и самый дешёвый вариант в пределах бюджета
+    double budget = args.getDouble("--budget", -1.0);
+    for (const auto& name : scenarios) {
+        std::cout << name << " (pareto front):" << std::endl;
+        const BenchResult* cheapest = nullptr;
+        for (const auto& r : results) {
+            if (r.scenario != name) continue;
+            if (r.pareto) {
+                char line[160];
+                std::snprintf(line, sizeof(line), "  %-6s dt=%-7g iter=%-3d damping=%-6g error=%-11.4g wall/sim s=%.4g",
+                              solver_name(r.config.solver), r.config.dt, r.config.iterations, r.config.damping,
+                              r.error, r.wall_per_sim_second);
+                std::cout << line << std::endl;
+            }
+            if (budget >= 0.0 && r.error <= budget &&
+                (!cheapest || r.wall_per_sim_second < cheapest->wall_per_sim_second)) {
+                cheapest = &r;
+            }
+        }
+        if (budget >= 0.0) {
+            if (cheapest) {
+                std::cout << "  cheapest within " << budget << ": " << solver_name(cheapest->config.solver)
+                          << " dt=" << cheapest->config.dt << " iter=" << cheapest->config.iterations
+                          << " damping=" << cheapest->config.damping << std::endl;
+            } else {
+                std::cout << "  nothing meets budget " << budget << std::endl;
+            }
+        }
+    }
+    return 0;
+}
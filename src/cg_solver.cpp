@@ -0,0 +1,228 @@
+#include "../include/cg_solver.h"
+#include "../include/physics_engine.h"
+#include <algorithm>
+#include <cmath>
+
+template <class Fn>
+void CGSolver::forChunks(TaskScheduler* scheduler, size_t n, Fn&& fn) const {
+    if (scheduler && n > CHUNK) {
+        scheduler->parallel_for(0, n, CHUNK, fn);
+    } else {
+        fn(0, n);
+    }
+}
+
+void CGSolver::build(const std::vector<Particle>& particles, const std::vector<Constraint>& constraints) {
+    size_t n = particles.size();
+    inv_mass.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        inv_mass[i] = particles[i].fixed ? 0.0 : particles[i].inv_mass;
+    }
+
+    i1.clear();
+    i2.clear();
+    rest.clear();
+    floor.clear();
+    alpha.clear();
+    diag_w.clear();
+    for (const auto& c : constraints) {
+        double total = inv_mass[c.particle1_idx] + inv_mass[c.particle2_idx];
+        if (total < 1e-9 || c.stiffness < 1e-9) continue;
+        i1.push_back(c.particle1_idx);
+        i2.push_back(c.particle2_idx);
+        rest.push_back(c.target_length);
+        floor.push_back(c.kind == ConstraintKind::Rope ? 0.0 : -1.0);
+        //у одиночной связи (w + alpha) dlambda = -C даёт поправку ровно stiffness * C
+        alpha.push_back(total * (1.0 / c.stiffness - 1.0));
+        diag_w.push_back(total);
+    }
+    size_t m = rest.size();
+    for (auto* v : {&nx, &ny, &active, &lambda, &r, &z, &p, &ap}) {
+        v->assign(m, 0.0);
+    }
+    warm.clear();
+
+    //у каждой частицы - список её связей (закреплённые не двигаются и не нужны)
+    incident_start.assign(n + 1, 0);
+    for (size_t k = 0; k < m; k++) {
+        if (inv_mass[i1[k]] > 0.0) incident_start[i1[k] + 1]++;
+        if (inv_mass[i2[k]] > 0.0) incident_start[i2[k] + 1]++;
+    }
+    for (size_t i = 0; i < n; i++) {
+        incident_start[i + 1] += incident_start[i];
+    }
+    incident.resize(incident_start[n]);
+    incident_s.resize(incident_start[n]);
+    std::vector<size_t> cursor(incident_start.begin(), incident_start.end() - 1);
+    for (size_t k = 0; k < m; k++) {
+        if (inv_mass[i1[k]] > 0.0) {
+            incident[cursor[i1[k]]] = k;
+            incident_s[cursor[i1[k]]++] = -1.0;
+        }
+        if (inv_mass[i2[k]] > 0.0) {
+            incident[cursor[i2[k]]] = k;
+            incident_s[cursor[i2[k]]++] = 1.0;
+        }
+    }
+    ux.assign(n, 0.0);
+    uy.assign(n, 0.0);
+}
+
+//суммы по кускам фиксированного размера и затем по порядку кусков:
+//от числа потоков не зависит ни результат, ни число шагов CG
+double CGSolver::dotChunks(TaskScheduler* scheduler, const std::vector<double>& a, const std::vector<double>& b) {
+    size_t m = a.size();
+    size_t chunks = (m + CHUNK - 1) / CHUNK;
+    partial.assign(chunks, 0.0);
+    auto sum = [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; c++) {
+            const double* __restrict pa = a.data();
+            const double* __restrict pb = b.data();
+            size_t end = std::min(m, (c + 1) * CHUNK);
+            double s = 0.0;
+            for (size_t k = c * CHUNK; k < end; k++) {
+                s += pa[k] * pb[k];
+            }
+            partial[c] = s;
+        }
+    };
+    if (scheduler && chunks > 1) {
+        scheduler->parallel_for(0, chunks, 1, sum);
+    } else {
+        sum(0, chunks);
+    }
+    double total = 0.0;
+    for (double s : partial) {
+        total += s;
+    }
+    return total;
+}
+
+void CGSolver::spread(TaskScheduler* scheduler, const std::vector<double>& v) {
+    forChunks(scheduler, inv_mass.size(), [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            double sx = 0.0, sy = 0.0;
+            for (size_t j = incident_start[i]; j < incident_start[i + 1]; j++) {
+                size_t k = incident[j];
+                double s = incident_s[j] * v[k];
+                sx += nx[k] * s;
+                sy += ny[k] * s;
+            }
+            ux[i] = sx * inv_mass[i];
+            uy[i] = sy * inv_mass[i];
+        }
+    });
+}
+
+void CGSolver::apply(TaskScheduler* scheduler, const std::vector<double>& v, std::vector<double>& out) {
+    spread(scheduler, v);
+    forChunks(scheduler, rest.size(), [&](size_t b, size_t e) {
+        for (size_t k = b; k < e; k++) {
+            double jv = nx[k] * (ux[i2[k]] - ux[i1[k]]) + ny[k] * (uy[i2[k]] - uy[i1[k]]);
+            //неактивная связь - единичная строка, её невязка и направление всегда 0
+            out[k] = active[k] > 0.0 ? jv + alpha[k] * v[k] : v[k];
+        }
+    });
+}
+
+int CGSolver::iterate(std::vector<Particle>& particles, int max_iterations, double tolerance, bool warm_start,
+                      TaskScheduler* scheduler) {
+    size_t m = rest.size();
+    last_iterations = 0;
+    if (m == 0) return 0;
+
+    //линеаризация: нормали, невязки и правая часть r = -C
+    forChunks(scheduler, m, [&](size_t b, size_t e) {
+        for (size_t k = b; k < e; k++) {
+            const Vec2d& x1 = particles[i1[k]].predicted_position;
+            const Vec2d& x2 = particles[i2[k]].predicted_position;
+            double dx = x2.x - x1.x;
+            double dy = x2.y - x1.y;
+            double len = std::sqrt(dx * dx + dy * dy);
+            double c = len - rest[k];
+            bool on = len > 1e-9 && (floor[k] < 0.0 || c > 0.0);
+            double inv = 1.0 / std::max(len, 1e-9);
+            nx[k] = dx * inv;
+            ny[k] = dy * inv;
+            active[k] = on ? 1.0 : 0.0;
+            r[k] = on ? -c : 0.0;
+        }
+    });
+    double b_norm = std::sqrt(dotChunks(scheduler, r, r));
+    if (b_norm < 1e-12) return 0;
+
+    //тёплый старт: множители прошлого шага близки к нынешним (та же нагрузка)
+    bool warm_ok = warm_start && warm.size() == m;
+    if (warm_ok) {
+        for (size_t k = 0; k < m; k++) {
+            lambda[k] = active[k] > 0.0 ? warm[k] : 0.0;
+        }
+        apply(scheduler, lambda, ap);
+        for (size_t k = 0; k < m; k++) {
+            r[k] -= ap[k];
+        }
+    } else {
+        std::fill(lambda.begin(), lambda.end(), 0.0);
+    }
+
+    auto precondition = [&](size_t b, size_t e) {
+        for (size_t k = b; k < e; k++) {
+            z[k] = r[k] / (diag_w[k] + alpha[k]);
+        }
+    };
+    forChunks(scheduler, m, precondition);
+    p = z;
+    double rz = dotChunks(scheduler, r, z);
+    double limit = tolerance * b_norm;
+
+    bool converged = false;
+    for (int it = 0; ; it++) {
+        converged = std::sqrt(dotChunks(scheduler, r, r)) <= limit;
+        if (converged || it == max_iterations) break;
+        apply(scheduler, p, ap);
+        double pap = dotChunks(scheduler, p, ap);
+        if (pap <= 0.0) break;
+        double step = rz / pap;
+        forChunks(scheduler, m, [&](size_t b, size_t e) {
+            double* __restrict l = lambda.data();
+            double* __restrict rr = r.data();
+            const double* __restrict pp = p.data();
+            const double* __restrict aa = ap.data();
+            for (size_t k = b; k < e; k++) {
+                l[k] += step * pp[k];
+                rr[k] -= step * aa[k];
+            }
+        });
+        forChunks(scheduler, m, precondition);
+        double rz_next = dotChunks(scheduler, r, z);
+        double beta = rz_next / rz;
+        rz = rz_next;
+        forChunks(scheduler, m, [&](size_t b, size_t e) {
+            double* __restrict pp = p.data();
+            const double* __restrict zz = z.data();
+            for (size_t k = b; k < e; k++) {
+                pp[k] = zz[k] + beta * pp[k];
+            }
+        });
+        last_iterations = it + 1;
+    }
+
+    //недорешённые множители в следующий шаг не несём: ошибка дальних мод, до которых
+    //CG не дотянулся, от шага к шагу накапливалась бы в скоростях
+    if (warm_start) {
+        if (converged) {
+            warm = lambda;
+        } else {
+            warm.clear();
+        }
+    }
+
+    //смещения частиц dx = W J^T lambda
+    spread(scheduler, lambda);
+    forChunks(scheduler, particles.size(), [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            particles[i].predicted_position += Vec2d{ux[i], uy[i]};
+        }
+    });
+    return last_iterations;
+}
@@ -0,0 +1,249 @@
+#include "../include/colliders.h"
+#include "../include/physics_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+    //кусок частиц на одну задачу поиска контактов
+    const size_t CONTACT_CHUNK = 1024;
+
+    bool overlaps(double a_min_x, double a_min_y, double a_max_x, double a_max_y,
+                  double b_min_x, double b_min_y, double b_max_x, double b_max_y) {
+        return a_min_x <= b_max_x && b_min_x <= a_max_x && a_min_y <= b_max_y && b_min_y <= a_max_y;
+    }
+}
+
+void StaticColliders::add(const Primitive& p) {
+    prims.push_back(p);
+    prim_boxes.push_back(bounds(p));
+    changes++;
+    dirty = true;
+}
+
+void StaticColliders::addSegment(const Vec2d& a, const Vec2d& b, double radius) {
+    add({Kind::Segment, a, b, std::max(0.0, radius)});
+}
+
+void StaticColliders::addCircle(const Vec2d& center, double radius) {
+    if (radius <= 0.0) {
+        throw std::invalid_argument("Collider radius must be positive");
+    }
+    add({Kind::Circle, center, center, radius});
+}
+
+void StaticColliders::addBox(const Vec2d& center, const Vec2d& half, double angle) {
+    std::vector<Vec2d> corners = {
+        center + rotate(angle, Vec2d{-half.x, -half.y}),
+        center + rotate(angle, Vec2d{half.x, -half.y}),
+        center + rotate(angle, Vec2d{half.x, half.y}),
+        center + rotate(angle, Vec2d{-half.x, half.y}),
+    };
+    addPolyline(corners, true);
+}
+
+void StaticColliders::addPolyline(const std::vector<Vec2d>& points, bool closed, double radius) {
+    if (points.size() < 2) return;
+    reserve(points.size());
+    for (size_t i = 0; i + 1 < points.size(); i++) {
+        addSegment(points[i], points[i + 1], radius);
+    }
+    if (closed && points.size() > 2) {
+        addSegment(points.back(), points.front(), radius);
+    }
+}
+
+void StaticColliders::clear() {
+    prims.clear();
+    prim_boxes.clear();
+    nodes.clear();
+    order.clear();
+    contact_particles.clear();
+    contact_start.clear();
+    contact_prims.clear();
+    changes++;
+    dirty = true;
+}
+
+StaticColliders::Box StaticColliders::bounds(const Primitive& p) const {
+    return Box{std::min(p.a.x, p.b.x) - p.radius, std::min(p.a.y, p.b.y) - p.radius,
+               std::max(p.a.x, p.b.x) + p.radius, std::max(p.a.y, p.b.y) + p.radius};
+}
+
+void StaticColliders::rebuild() {
+    nodes.clear();
+    order.resize(prims.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    nodes.reserve(2 * prims.size() / LEAF_SIZE + 1);
+    if (!prims.empty()) build(0, prims.size());
+    dirty = false;
+}
+
+//делим по медиане центров вдоль длинной стороны: глубина log(n) при любой геометрии
+int StaticColliders::build(size_t first, size_t count) {
+    int id = static_cast<int>(nodes.size());
+    nodes.push_back(Node{});
+
+    Box box = prim_boxes[order[first]];
+    for (size_t k = first + 1; k < first + count; k++) {
+        const Box& b = prim_boxes[order[k]];
+        box.min_x = std::min(box.min_x, b.min_x);
+        box.min_y = std::min(box.min_y, b.min_y);
+        box.max_x = std::max(box.max_x, b.max_x);
+        box.max_y = std::max(box.max_y, b.max_y);
+    }
+    nodes[id].box = box;
+
+    if (count <= LEAF_SIZE) {
+        nodes[id].left = nodes[id].right = -1;
+        nodes[id].first = first;
+        nodes[id].count = count;
+        return id;
+    }
+
+    bool split_x = box.max_x - box.min_x >= box.max_y - box.min_y;
+    auto center = [this, split_x](size_t i) {
+        const Box& b = prim_boxes[i];
+        return split_x ? b.min_x + b.max_x : b.min_y + b.max_y;
+    };
+    size_t half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                     [&center](size_t a, size_t b) { return center(a) < center(b); });
+
+    int left = build(first, half);
+    int right = build(first + half, count - half);
+    nodes[id].left = left;
+    nodes[id].right = right;
+    nodes[id].first = 0;
+    nodes[id].count = 0;
+    return id;
+}
+
+template <class Fn>
+void StaticColliders::query(const Box& box, Fn&& fn) const {
+    if (nodes.empty()) return;
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (!overlaps(box.min_x, box.min_y, box.max_x, box.max_y,
+                      node.box.min_x, node.box.min_y, node.box.max_x, node.box.max_y)) {
+            continue;
+        }
+        if (node.left < 0) {
+            for (size_t k = node.first; k < node.first + node.count; k++) {
+                const Box& b = prim_boxes[order[k]];
+                if (overlaps(box.min_x, box.min_y, box.max_x, box.max_y, b.min_x, b.min_y, b.max_x, b.max_y)) {
+                    fn(order[k]);
+                }
+            }
+            continue;
+        }
+        stack[top++] = node.left;
+        stack[top++] = node.right;
+    }
+}
+
+void StaticColliders::findContacts(const std::vector<Particle>& particles, double particle_radius,
+                                   TaskScheduler* scheduler) {
+    if (dirty) rebuild();
+    contact_particles.clear();
+    contact_start.clear();
+    contact_prims.clear();
+    if (prims.empty()) return;
+
+    //каждый кусок пишет свои контакты, потом склеиваем по порядку кусков -
+    //результат не зависит от числа потоков
+    size_t chunks = (particles.size() + CONTACT_CHUNK - 1) / CONTACT_CHUNK;
+    std::vector<std::vector<std::pair<size_t, size_t>>> found(chunks);
+    auto scan = [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; c++) {
+            auto& out = found[c];
+            out.clear();
+            size_t end = std::min(particles.size(), (c + 1) * CONTACT_CHUNK);
+            for (size_t i = c * CONTACT_CHUNK; i < end; i++) {
+                const Particle& p = particles[i];
+                //частицы с бесконечной массой контакты не двигают, как и связи
+                if (p.fixed || p.inv_mass <= 0.0) continue;
+                //путь от начала шага до текущей предсказанной позиции целиком:
+                //быструю частицу не пропустим сквозь тонкую стенку
+                Box swept{std::min(p.position.x, p.predicted_position.x) - particle_radius,
+                          std::min(p.position.y, p.predicted_position.y) - particle_radius,
+                          std::max(p.position.x, p.predicted_position.x) + particle_radius,
+                          std::max(p.position.y, p.predicted_position.y) + particle_radius};
+                query(swept, [&out, i](size_t prim) { out.emplace_back(i, prim); });
+            }
+        }
+    };
+    if (scheduler && chunks > 1) {
+        scheduler->parallel_for(0, chunks, 1, scan);
+    } else {
+        scan(0, chunks);
+    }
+
+    for (const auto& chunk : found) {
+        for (const auto& [particle, prim] : chunk) {
+            if (contact_particles.empty() || contact_particles.back() != particle) {
+                contact_particles.push_back(particle);
+                contact_start.push_back(contact_prims.size());
+            }
+            contact_prims.push_back(prim);
+        }
+    }
+    contact_start.push_back(contact_prims.size());
+}
+
+void StaticColliders::resolveContacts(std::vector<Particle>& particles, double particle_radius,
+                                      TaskScheduler* scheduler) const {
+    auto resolve = [&](size_t kb, size_t ke) {
+        for (size_t k = kb; k < ke; k++) {
+            Particle& p = particles[contact_particles[k]];
+            Vec2d& x = p.predicted_position;
+            for (size_t j = contact_start[k]; j < contact_start[k + 1]; j++) {
+                const Primitive& prim = prims[contact_prims[j]];
+                double reach = prim.radius + particle_radius;
+
+                if (prim.kind == Kind::Segment) {
+                    Vec2d ab = prim.b - prim.a;
+                    double len2 = dot(ab, ab);
+                    double t = len2 > 1e-12 ? dot(x - prim.a, ab) / len2 : -1.0;
+                    if (t > 0.0 && t < 1.0) {
+                        //нормаль смотрит туда, где частица была в начале шага:
+                        //перелетевшую стенку за шаг возвращаем на её сторону
+                        Vec2d n = Vec2d{-ab.y, ab.x} / std::sqrt(len2);
+                        if (dot(p.position - prim.a, n) < 0.0) n = -n;
+                        double side = dot(x - prim.a, n);
+                        if (side < reach) x += n * (reach - side);
+                        continue;
+                    }
+                    //за концами отрезок - это круглые торцы
+                    const Vec2d& end = t <= 0.0 ? prim.a : prim.b;
+                    Vec2d d = x - end;
+                    double dist = std::sqrt(dot(d, d));
+                    if (dist < reach && dist > 1e-12) x = end + d * (reach / dist);
+                    continue;
+                }
+
+                Vec2d d = x - prim.a;
+                double dist = std::sqrt(dot(d, d));
+                if (dist >= reach) continue;
+                //в самом центре направление берём от начала шага
+                if (dist < 1e-12) {
+                    d = p.position - prim.a;
+                    dist = std::sqrt(dot(d, d));
+                    if (dist < 1e-12) continue;
+                }
+                x = prim.a + d * (reach / dist);
+            }
+        }
+    };
+    size_t n = contact_particles.size();
+    if (scheduler && n > CONTACT_CHUNK) {
+        scheduler->parallel_for(0, n, CONTACT_CHUNK, resolve);
+    } else {
+        resolve(0, n);
+    }
+}
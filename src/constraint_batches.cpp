@@ -0,0 +1,129 @@
+#include "../include/constraint_batches.h"
+#include "../include/physics_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+    const size_t NONE = size_t(-1);
+
+    //раскладываем элементы по островам подсчётом, порядок внутри острова сохраняется
+    template <class Item, class Batch>
+    void fill_batch(Batch& batch, const std::vector<Item>& items, const std::vector<size_t>& island_of,
+                    size_t island_count) {
+        batch.offsets.assign(island_count + 1, 0);
+        for (size_t id : island_of) {
+            batch.offsets[id + 1]++;
+        }
+        for (size_t k = 0; k < island_count; k++) {
+            batch.offsets[k + 1] += batch.offsets[k];
+        }
+        batch.items.resize(items.size());
+        std::vector<size_t> cursor(batch.offsets.begin(), batch.offsets.end() - 1);
+        for (size_t k = 0; k < items.size(); k++) {
+            batch.items[cursor[island_of[k]]++] = items[k];
+        }
+    }
+}
+
+void ConstraintBatches::build(const std::vector<Particle>& particles, const std::vector<Constraint>& constraints,
+                              const std::vector<AngleConstraint>& angles) {
+    auto weight = [&particles](size_t i) {
+        const Particle& p = particles[i];
+        return p.fixed ? 0.0 : p.inv_mass;
+    };
+
+    //острова: объединяем только подвижные частицы, опоры лишь читаются
+    std::vector<size_t> parent(particles.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&parent](size_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+    auto unite = [&](size_t a, size_t b) {
+        if (weight(a) <= 0.0 || weight(b) <= 0.0) return;
+        a = find(a);
+        b = find(b);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    };
+    for (const auto& c : constraints) {
+        unite(c.particle1_idx, c.particle2_idx);
+    }
+    for (const auto& a : angles) {
+        unite(a.a, a.center);
+        unite(a.center, a.b);
+        unite(a.a, a.b);
+    }
+
+    std::vector<size_t> island_of_root(particles.size(), NONE);
+    island_count = 0;
+    auto island_for = [&](size_t idx) {
+        size_t root = find(idx);
+        if (island_of_root[root] == NONE) island_of_root[root] = island_count++;
+        return island_of_root[root];
+    };
+
+    std::vector<PairItem> rod_items, spring_items, rope_items;
+    std::vector<PinnedItem> pinned_items;
+    std::vector<AngleItem> angle_list;
+    std::vector<size_t> rod_ids, spring_ids, rope_ids, pinned_ids, angle_ids;
+
+    for (const auto& c : constraints) {
+        if (c.stiffness < 1e-9) continue;
+        double w1 = weight(c.particle1_idx);
+        double w2 = weight(c.particle2_idx);
+        double total = w1 + w2;
+        if (total < 1e-9) continue;
+
+        size_t island = island_for(w1 > 0.0 ? c.particle1_idx : c.particle2_idx);
+        PairItem item{c.particle1_idx, c.particle2_idx, c.target_length,
+                      w1 / total * c.stiffness, w2 / total * c.stiffness};
+
+        if (c.kind == ConstraintKind::Rope) {
+            rope_items.push_back(item);
+            rope_ids.push_back(island);
+        } else if (w1 <= 0.0 || w2 <= 0.0) {
+            bool first_free = w1 > 0.0;
+            pinned_items.push_back({first_free ? c.particle1_idx : c.particle2_idx,
+                                    first_free ? c.particle2_idx : c.particle1_idx,
+                                    c.target_length, c.stiffness});
+            pinned_ids.push_back(island);
+        } else if (c.stiffness >= 1.0) {
+            rod_items.push_back(item);
+            rod_ids.push_back(island);
+        } else {
+            spring_items.push_back(item);
+            spring_ids.push_back(island);
+        }
+    }
+
+    for (const auto& a : angles) {
+        double wa = weight(a.a);
+        double wb = weight(a.b);
+        double total = wa + wb;
+        if (total < 1e-9 || a.stiffness < 1e-9) continue;
+        angle_list.push_back({a.a, a.center, a.b, a.min_angle, a.max_angle,
+                              wa / total * a.stiffness, wb / total * a.stiffness});
+        angle_ids.push_back(island_for(wa > 0.0 ? a.a : a.b));
+    }
+
+    //пружины после стержней: порядок в острове тот же, что был у двух отдельных проходов
+    rod_items.insert(rod_items.end(), spring_items.begin(), spring_items.end());
+    rod_ids.insert(rod_ids.end(), spring_ids.begin(), spring_ids.end());
+    fill_batch(links, rod_items, rod_ids, island_count);
+    fill_batch(pinned, pinned_items, pinned_ids, island_count);
+    fill_batch(ropes, rope_items, rope_ids, island_count);
+    fill_batch(angle_items, angle_list, angle_ids, island_count);
+}
+
+void ConstraintBatches::solveIsland(size_t island, std::vector<Particle>& particles, int iterations) const {
+    solveIslandAt(island, [&particles](size_t i) -> Vec2d& { return particles[i].predicted_position; },
+                  iterations);
+}
+
+void ConstraintBatches::solveAngles(std::vector<Particle>& particles) const {
+    solveAnglesAt([&particles](size_t i) -> Vec2d& { return particles[i].predicted_position; });
+}
@@ -0,0 +1,182 @@
+#include "../include/diagnostics.h"
+#include "../include/physics_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    //кусок фиксированного размера: границы не зависят от числа потоков
+    constexpr size_t DIAG_CHUNK = 8192;
+    constexpr double INF = std::numeric_limits<double>::infinity();
+
+    template <class Fn>
+    void for_chunks(TaskScheduler* scheduler, size_t chunks, Fn&& fn) {
+        if (scheduler && chunks > 1) {
+            scheduler->parallel_for(0, chunks, 1, fn);
+        } else {
+            fn(0, chunks);
+        }
+    }
+}
+
+double metricValue(const DiagnosticsSample& s, DiagnosticMetric metric) {
+    switch (metric) {
+    case DiagnosticMetric::EnergyDrift: return std::abs(s.energy_drift);
+    case DiagnosticMetric::Momentum: return leight(s.momentum);
+    case DiagnosticMetric::MaxStretch: return s.max_stretch;
+    case DiagnosticMetric::RmsStretch: return s.rms_stretch;
+    }
+    return 0.0;
+}
+
+const char* metricName(DiagnosticMetric metric) {
+    switch (metric) {
+    case DiagnosticMetric::EnergyDrift: return "energy drift";
+    case DiagnosticMetric::Momentum: return "momentum";
+    case DiagnosticMetric::MaxStretch: return "max stretch";
+    case DiagnosticMetric::RmsStretch: return "rms stretch";
+    }
+    return "?";
+}
+
+void Diagnostics::configure(size_t history, size_t interval) {
+    ring.assign(history, DiagnosticsSample{});
+    every = interval > 0 ? interval : 1;
+    head = 0;
+    count = 0;
+    have_reference = false;
+    resetTripped();
+}
+
+void Diagnostics::resetTripped() {
+    any_tripped = false;
+    for (auto& t : thresholds) {
+        t.over = false;
+    }
+}
+
+size_t Diagnostics::addThreshold(DiagnosticMetric metric, double bound, ThresholdCallback callback) {
+    thresholds.push_back({metric, bound, std::move(callback), false});
+    return thresholds.size() - 1;
+}
+
+std::vector<DiagnosticsSample> Diagnostics::history() const {
+    std::vector<DiagnosticsSample> out;
+    out.reserve(count);
+    for (size_t k = 0; k < count; k++) {
+        out.push_back(at(k));
+    }
+    return out;
+}
+
+void Diagnostics::sample(const std::vector<Particle>& particles, const std::vector<Constraint>& constraints,
+                         const Vec2d& gravity, double time, std::uint64_t step, size_t topology_version,
+                         TaskScheduler* scheduler) {
+    if (ring.empty()) return;
+
+    //частицы: ветвлений нет, закреплённые входят с нулевой массой
+    size_t n = particles.size();
+    size_t p_chunks = (n + DIAG_CHUNK - 1) / DIAG_CHUNK;
+    particle_parts.resize(p_chunks);
+    for_chunks(scheduler, p_chunks, [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; c++) {
+            size_t last = std::min(n, (c + 1) * DIAG_CHUNK);
+            double ke = 0.0, pe = 0.0, px = 0.0, py = 0.0, mass = 0.0;
+            Vec2d lo{INF, INF}, hi{-INF, -INF};
+            for (size_t i = c * DIAG_CHUNK; i < last; i++) {
+                const Particle& p = particles[i];
+                double m = p.inv_mass > 0.0 ? 1.0 / p.inv_mass : 0.0;
+                ke += 0.5 * m * dot(p.velocity, p.velocity);
+                pe -= m * dot(gravity, p.position);
+                px += m * p.velocity.x;
+                py += m * p.velocity.y;
+                mass += m;
+                lo.x = std::min(lo.x, p.position.x);
+                lo.y = std::min(lo.y, p.position.y);
+                hi.x = std::max(hi.x, p.position.x);
+                hi.y = std::max(hi.y, p.position.y);
+            }
+            particle_parts[c] = {ke, pe, px, py, mass, lo, hi};
+        }
+    });
+
+    //связи: растяжение относительно длины покоя
+    size_t m = constraints.size();
+    size_t c_chunks = (m + DIAG_CHUNK - 1) / DIAG_CHUNK;
+    constraint_parts.resize(c_chunks);
+    for_chunks(scheduler, c_chunks, [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; c++) {
+            size_t last = std::min(m, (c + 1) * DIAG_CHUNK);
+            double worst = 0.0, sum_sq = 0.0;
+            for (size_t k = c * DIAG_CHUNK; k < last; k++) {
+                const Constraint& con = constraints[k];
+                Vec2d d = particles[con.particle2_idx].position - particles[con.particle1_idx].position;
+                double s = (std::sqrt(dot(d, d)) - con.target_length) / con.target_length;
+                s = con.kind == ConstraintKind::Rope ? std::max(s, 0.0) : std::abs(s);
+                //NaN не должен потеряться в max
+                worst = s > worst || s != s ? s : worst;
+                sum_sq += s * s;
+            }
+            constraint_parts[c] = {worst, sum_sq};
+        }
+    });
+
+    DiagnosticsSample s;
+    s.step = step;
+    s.time = time;
+    double px = 0.0, py = 0.0, mass = 0.0;
+    Vec2d lo{INF, INF}, hi{-INF, -INF};
+    for (const ParticlePart& part : particle_parts) {
+        s.kinetic += part.kinetic;
+        s.potential += part.potential;
+        px += part.px;
+        py += part.py;
+        mass += part.mass;
+        lo.x = std::min(lo.x, part.lo.x);
+        lo.y = std::min(lo.y, part.lo.y);
+        hi.x = std::max(hi.x, part.hi.x);
+        hi.y = std::max(hi.y, part.hi.y);
+    }
+    s.total = s.kinetic + s.potential;
+    s.momentum = {px, py};
+    double sum_sq = 0.0;
+    for (const ConstraintPart& part : constraint_parts) {
+        s.max_stretch = part.max_stretch > s.max_stretch || part.max_stretch != part.max_stretch
+                        ? part.max_stretch : s.max_stretch;
+        sum_sq += part.sum_sq;
+    }
+    s.rms_stretch = m > 0 ? std::sqrt(sum_sq / double(m)) : 0.0;
+
+    //опора: E0 и масштаб - энергия подъёма всей массы на размер сцены (диагональ рамки)
+    //плюс начальная кинетическая; ноль потенциальной энергии произволен, делить на |E0| нельзя
+    if (!have_reference || topology_version != reference_version || step < last_step) {
+        have_reference = true;
+        reference_version = topology_version;
+        reference_energy = s.total;
+        double extent = n > 0 ? leight(hi - lo) : 0.0;
+        energy_scale = mass * leight(gravity) * extent + s.kinetic;
+        if (!(energy_scale > 0.0)) energy_scale = 1.0;
+    }
+    last_step = step;
+    s.energy_drift = (s.total - reference_energy) / energy_scale;
+
+    size_t idx;
+    if (count < ring.size()) {
+        idx = (head + count) % ring.size();
+        count++;
+    } else {
+        idx = head;
+        head = (head + 1) % ring.size();
+    }
+    ring[idx] = s;
+
+    for (Threshold& t : thresholds) {
+        double v = metricValue(s, t.metric);
+        bool over = !(v <= t.bound);
+        if (over && !t.over) {
+            any_tripped = true;
+            if (t.callback) t.callback(s, t.metric, v);
+        }
+        t.over = over;
+    }
+}
@@ -0,0 +1,293 @@
+#include "../include/force_fields.h"
+#include "../include/physics_engine.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+void ForceField::touch() {
+    static std::atomic<std::uint64_t> last_change{0};
+    changed_at = ++last_change;
+}
+
+void FieldContext::forRange(size_t n, const std::function<void(size_t, size_t)>& fn) const {
+    if (scheduler && n > grain) {
+        scheduler->parallel_for(0, n, grain, fn);
+    } else {
+        fn(0, n);
+    }
+}
+
+void UniformField::accumulate(const std::vector<Particle>& particles, std::vector<Vec2d>& forces,
+                              const FieldContext& ctx) {
+    ctx.forRange(particles.size(), [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            if (particles[i].inv_mass > 0.0) {
+                forces[i] += acceleration / particles[i].inv_mass;
+            }
+        }
+    });
+}
+
+void PointAttractor::accumulate(const std::vector<Particle>& particles, std::vector<Vec2d>& forces,
+                                const FieldContext& ctx) {
+    double soft2 = softening * softening;
+    ctx.forRange(particles.size(), [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            const Particle& p = particles[i];
+            if (p.inv_mass <= 0.0) continue;
+            Vec2d d = center - p.position;
+            double r2 = dot(d, d) + soft2;
+            double inv = strength / (r2 * std::sqrt(r2));
+            forces[i] += d * (inv / p.inv_mass);
+        }
+    });
+}
+
+void DragField::accumulate(const std::vector<Particle>& particles, std::vector<Vec2d>& forces,
+                           const FieldContext& ctx) {
+    ctx.forRange(particles.size(), [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            const Vec2d& v = particles[i].velocity;
+            forces[i] -= v * (linear + quadratic * leight(v));
+        }
+    });
+}
+
+void SpringField::accumulate(const std::vector<Particle>& particles, std::vector<Vec2d>& forces,
+                             const FieldContext&) {
+    //пружин обычно немного, а частица-частица пишет в две силы сразу - считаем в одном потоке
+    for (const auto& a : anchors) {
+        if (a.idx >= particles.size()) continue;
+        Vec2d d = particles[a.idx].position - a.point;
+        double len = leight(d);
+        if (len < 1e-12) continue;
+        forces[a.idx] -= d * (a.k * (len - a.rest) / len);
+    }
+    for (const auto& s : springs) {
+        if (s.idx1 >= particles.size() || s.idx2 >= particles.size()) continue;
+        Vec2d d = particles[s.idx2].position - particles[s.idx1].position;
+        double len = leight(d);
+        if (len < 1e-12) continue;
+        Vec2d f = d * (s.k * (len - s.rest) / len);
+        forces[s.idx1] += f;
+        forces[s.idx2] -= f;
+    }
+}
+
+void SpringField::remapParticles(const std::vector<size_t>& new_of_old, size_t) {
+    auto remap = [&new_of_old](size_t idx) {
+        return idx < new_of_old.size() ? new_of_old[idx] : NO_PARTICLE;
+    };
+    //пружины удалённых частиц уходят вместе с ними
+    size_t kept = 0;
+    for (auto a : anchors) {
+        a.idx = remap(a.idx);
+        if (a.idx != NO_PARTICLE) anchors[kept++] = a;
+    }
+    anchors.erase(anchors.begin() + kept, anchors.end());
+    kept = 0;
+    for (auto s : springs) {
+        s.idx1 = remap(s.idx1);
+        s.idx2 = remap(s.idx2);
+        if (s.idx1 != NO_PARTICLE && s.idx2 != NO_PARTICLE) springs[kept++] = s;
+    }
+    springs.erase(springs.begin() + kept, springs.end());
+}
+
+double PairwiseField::sourceStrength(const Particle& p, size_t idx) const {
+    if (kind == Kind::Gravity) {
+        //у закреплённых частиц массы нет (inv_mass = 0), источником они не служат
+        return p.inv_mass > 0.0 ? 1.0 / p.inv_mass : 0.0;
+    }
+    return idx < charges.size() ? charges[idx] : 1.0;
+}
+
+void PairwiseField::remapParticles(const std::vector<size_t>& new_of_old, size_t new_count) {
+    if (charges.empty()) return;
+    //частицы без заряда считались с зарядом 1 - после перестановки явно сохраняем это;
+    //новые частицы тоже получают 1, заряды удалённых пропадают
+    std::vector<double> moved(new_count, 1.0);
+    for (size_t i = 0; i < new_of_old.size(); i++) {
+        size_t j = new_of_old[i];
+        if (j == NO_PARTICLE || j >= new_count) continue;
+        moved[j] = i < charges.size() ? charges[i] : 1.0;
+    }
+    charges = std::move(moved);
+}
+
+int PairwiseField::build(size_t first, size_t count, double min_x, double min_y, double size, int depth) {
+    int id = static_cast<int>(nodes.size());
+    nodes.push_back(Node{min_x, min_y, size, 0.0, 0.0, 0.0, 0.0, {-1, -1, -1, -1}, first, count});
+
+    if (count <= LEAF_SIZE || depth >= 48) {
+        double s = 0.0, wsum = 0.0, cx = 0.0, cy = 0.0;
+        for (size_t k = first; k < first + count; k++) {
+            size_t j = order[k];
+            double w = std::abs(src_s[j]);
+            s += src_s[j];
+            wsum += w;
+            cx += src_x[j] * w;
+            cy += src_y[j] * w;
+        }
+        Node& n = nodes[id];
+        n.strength = s;
+        n.weight = wsum;
+        n.cx = wsum > 0.0 ? cx / wsum : min_x + size * 0.5;
+        n.cy = wsum > 0.0 ? cy / wsum : min_y + size * 0.5;
+        return id;
+    }
+
+    //делим на четверти: сначала по y, потом каждую половину по x
+    double half = size * 0.5;
+    double mid_x = min_x + half;
+    double mid_y = min_y + half;
+    auto begin = order.begin() + first;
+    auto end = begin + count;
+    auto split_y = std::partition(begin, end, [&](size_t j) { return src_y[j] < mid_y; });
+    auto split_lo = std::partition(begin, split_y, [&](size_t j) { return src_x[j] < mid_x; });
+    auto split_hi = std::partition(split_y, end, [&](size_t j) { return src_x[j] < mid_x; });
+
+    size_t bounds[5] = {
+        first,
+        first + size_t(split_lo - begin),
+        first + size_t(split_y - begin),
+        first + size_t(split_hi - begin),
+        first + count
+    };
+    double qx[4] = {min_x, mid_x, min_x, mid_x};
+    double qy[4] = {min_y, min_y, mid_y, mid_y};
+
+    double s = 0.0, wsum = 0.0, cx = 0.0, cy = 0.0;
+    for (int q = 0; q < 4; q++) {
+        size_t n = bounds[q + 1] - bounds[q];
+        if (n == 0) continue;
+        int child = build(bounds[q], n, qx[q], qy[q], half, depth + 1);
+        nodes[id].child[q] = child;
+
+        const Node& c = nodes[child];
+        s += c.strength;
+        wsum += c.weight;
+        cx += c.cx * c.weight;
+        cy += c.cy * c.weight;
+    }
+    Node& n = nodes[id];
+    n.strength = s;
+    n.weight = wsum;
+    n.cx = wsum > 0.0 ? cx / wsum : mid_x;
+    n.cy = wsum > 0.0 ? cy / wsum : mid_y;
+    return id;
+}
+
+Vec2d PairwiseField::evaluate(double x, double y) const {
+    double eps2 = std::max(softening * softening, 1e-12);
+    double theta2 = theta * theta;
+    double ax = 0.0, ay = 0.0;
+
+    int stack[4 * 64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& n = nodes[stack[--top]];
+        double dx = n.cx - x;
+        double dy = n.cy - y;
+        double d2 = dx * dx + dy * dy;
+
+        bool leaf = n.child[0] < 0 && n.child[1] < 0 && n.child[2] < 0 && n.child[3] < 0;
+        if (!leaf && n.size * n.size < theta2 * d2) {
+            //узел далеко - заменяем его одним источником в центре
+            double r2 = d2 + eps2;
+            double inv = n.strength / (r2 * std::sqrt(r2));
+            ax += dx * inv;
+            ay += dy * inv;
+            continue;
+        }
+        if (!leaf) {
+            for (int q = 0; q < 4; q++) {
+                if (n.child[q] >= 0) stack[top++] = n.child[q];
+            }
+            continue;
+        }
+
+        //лист - прямое суммирование по плотным массивам, четыре независимые суммы
+        //дают компилятору векторизовать цикл без переупорядочивания сложений
+        const double* bx = leaf_x.data() + n.first;
+        const double* by = leaf_y.data() + n.first;
+        const double* bs = leaf_s.data() + n.first;
+        double lx[4] = {0, 0, 0, 0};
+        double ly[4] = {0, 0, 0, 0};
+        size_t k = 0;
+        for (; k + 4 <= n.count; k += 4) {
+            for (int l = 0; l < 4; l++) {
+                double ex = bx[k + l] - x;
+                double ey = by[k + l] - y;
+                double r2 = ex * ex + ey * ey + eps2;
+                double inv = bs[k + l] / (r2 * std::sqrt(r2));
+                lx[l] += ex * inv;
+                ly[l] += ey * inv;
+            }
+        }
+        for (; k < n.count; k++) {
+            double ex = bx[k] - x;
+            double ey = by[k] - y;
+            double r2 = ex * ex + ey * ey + eps2;
+            double inv = bs[k] / (r2 * std::sqrt(r2));
+            lx[0] += ex * inv;
+            ly[0] += ey * inv;
+        }
+        ax += (lx[0] + lx[1]) + (lx[2] + lx[3]);
+        ay += (ly[0] + ly[1]) + (ly[2] + ly[3]);
+    }
+    return Vec2d{ax, ay};
+}
+
+void PairwiseField::accumulate(const std::vector<Particle>& particles, std::vector<Vec2d>& forces,
+                               const FieldContext& ctx) {
+    //источники с ненулевой силой
+    src_x.clear();
+    src_y.clear();
+    src_s.clear();
+    double min_x = 1e300, min_y = 1e300, max_x = -1e300, max_y = -1e300;
+    for (size_t i = 0; i < particles.size(); i++) {
+        double s = sourceStrength(particles[i], i);
+        if (s == 0.0) continue;
+        const Vec2d& p = particles[i].position;
+        src_x.push_back(p.x);
+        src_y.push_back(p.y);
+        src_s.push_back(s);
+        min_x = std::min(min_x, p.x);
+        min_y = std::min(min_y, p.y);
+        max_x = std::max(max_x, p.x);
+        max_y = std::max(max_y, p.y);
+    }
+    if (src_s.empty()) return;
+
+    order.resize(src_s.size());
+    for (size_t k = 0; k < order.size(); k++) order[k] = k;
+    nodes.clear();
+    double size = std::max(max_x - min_x, max_y - min_y) * (1.0 + 1e-9) + 1e-9;
+    build(0, order.size(), min_x, min_y, size, 0);
+
+    leaf_x.resize(order.size());
+    leaf_y.resize(order.size());
+    leaf_s.resize(order.size());
+    for (size_t k = 0; k < order.size(); k++) {
+        leaf_x[k] = src_x[order[k]];
+        leaf_y[k] = src_y[order[k]];
+        leaf_s[k] = src_s[order[k]];
+    }
+
+    //обход дерева для каждой частицы независим - параллелим по частицам
+    ctx.forRange(particles.size(), [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            const Particle& p = particles[i];
+            double scale;
+            if (kind == Kind::Gravity) {
+                if (p.inv_mass <= 0.0) continue;
+                scale = coupling / p.inv_mass;
+            } else {
+                scale = -coupling * (i < charges.size() ? charges[i] : 1.0);
+            }
+            forces[i] += evaluate(p.position.x, p.position.y) * scale;
+        }
+    });
+}
@@ -0,0 +1,339 @@
+#include "../include/headless.h"
+#include "../include/trace.h"
+#include "../include/benchmark.h"
+#include "../include/quality_controller.h"
+#include "../include/tangent_stepper.h"
+#include "../include/sweep.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    using HashTrace = std::vector<std::pair<std::uint64_t, std::uint64_t>>;
+
+    //движок с теми же настройками, что и в окне
+    PhysicsEngine make_engine(const CliArgs& args) {
+        PhysicsEngine engine(Vec2d(0, 300.0), args.getDouble("--dt", 0.016),
+                             static_cast<int>(args.getInt("--iterations", 10)),
+                             args.getDouble("--damping", 0.0));
+        engine.setThreadCount(static_cast<unsigned>(args.getInt("--threads", 0)));
+        //--solver jacobi [--relaxation w]: решатель Якоби вместо Гаусса-Зейделя
+        //--solver cg [--cg-iterations n --cg-tolerance t]: сопряжённые градиенты
+        if (args.get("--solver") == "jacobi") {
+            engine.setSolverMode(SolverMode::Jacobi);
+            engine.setJacobiRelaxation(args.getDouble("--relaxation", 1.5));
+        } else if (args.get("--solver") == "cg") {
+            engine.setSolverMode(SolverMode::ConjugateGradient);
+            engine.setCGParameters(args.getInt("--cg-iterations", 30), args.getDouble("--cg-tolerance", 1e-4));
+        }
+        return engine;
+    }
+
+    HashTrace run_trace(PhysicsEngine& engine, const CliArgs& args) {
+        build_scene(engine, args.get("--scene", "chain"), static_cast<size_t>(args.getInt("--size", 64)));
+        //--reorder bfs|rcm: перенумерация по связям перед первым шагом
+        std::string reorder = args.get("--reorder");
+        if (reorder == "bfs") engine.setAutoReorder(ReorderMethod::BFS);
+        else if (reorder == "rcm") engine.setAutoReorder(ReorderMethod::ReverseCuthillMcKee);
+        else if (!reorder.empty()) std::cerr << "Unknown reorder method " << reorder << ", ignored" << std::endl;
+        engine.setHashInterval(static_cast<size_t>(args.getInt("--hash-every", 1)));
+        long long steps = args.getInt("--steps", 1000);
+        //--frame-budget ms: --steps кадров под контролем качества (след тогда зависит от машины)
+        if (args.has("--frame-budget")) {
+            QualityController quality(engine, engine.getTimeStep());
+            quality.setBudget(args.getDouble("--frame-budget", 8.0));
+            quality.setMinLevel(static_cast<size_t>(args.getInt("--min-quality", 0)));
+            quality.setLevelListener([&quality, &engine](size_t level) {
+                std::cout << "step " << engine.getStepCount() << ": quality " << level << " ("
+                          << quality.currentLevel().substeps << "x" << quality.currentLevel().iterations
+                          << ", " << quality.averageCost() << " ms)" << std::endl;
+            });
+            for (long long i = 0; i < steps; i++) {
+                quality.advance();
+            }
+            return engine.getHashTrace();
+        }
+        for (long long i = 0; i < steps; i++) {
+            engine.step();
+        }
+        return engine.getHashTrace();
+    }
+
+    bool read_trace(const std::string& path, HashTrace& trace) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Cannot open trace " << path << std::endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream ss(line);
+            std::uint64_t step, hash;
+            ss >> step >> std::hex >> hash;
+            if (ss) trace.emplace_back(step, hash);
+        }
+        return true;
+    }
+
+    //номер первого шага, на котором следы различаются; 0 - совпадают
+    std::uint64_t first_divergence(const HashTrace& a, const HashTrace& b) {
+        size_t n = std::min(a.size(), b.size());
+        for (size_t i = 0; i < n; i++) {
+            if (a[i] != b[i]) return std::min(a[i].first, b[i].first);
+        }
+        if (a.size() != b.size()) {
+            return (a.size() > n ? a[n].first : b[n].first);
+        }
+        return 0;
+    }
+
+    int report_divergence(const HashTrace& a, const HashTrace& b) {
+        std::uint64_t step = first_divergence(a, b);
+        if (step == 0) {
+            std::cout << "Traces match (" << a.size() << " hashes)" << std::endl;
+            return 0;
+        }
+        std::cout << "First diverging step: " << step << std::endl;
+        return 1;
+    }
+
+    int trace_mode(const CliArgs& args) {
+        std::string path = args.get("--trace");
+        std::string events_path = args.get("--trace-events");
+        Trace::setEnabled(!events_path.empty());
+        Trace::setThreadName("main");
+        PhysicsEngine engine = make_engine(args);
+        HashTrace trace = run_trace(engine, args);
+        if (!events_path.empty() && !Trace::writeJson(events_path)) {
+            std::cerr << "Cannot write trace events " << events_path << std::endl;
+        }
+
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Cannot write trace " << path << std::endl;
+            return 2;
+        }
+        out << "# scene=" << args.get("--scene", "chain") << " size=" << args.getInt("--size", 64)
+            << " threads=" << engine.getThreadCount() << "\n";
+        char buf[32];
+        for (const auto& [step, hash] : trace) {
+            std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash));
+            out << step << " " << buf << "\n";
+        }
+        std::cout << "Wrote " << trace.size() << " hashes to " << path << std::endl;
+        return 0;
+    }
+
+    int compare_mode(const CliArgs& args) {
+        std::vector<std::string> files = args.values("--compare");
+        if (files.size() != 2) {
+            std::cerr << "--compare needs two trace files" << std::endl;
+            return 2;
+        }
+        HashTrace a, b;
+        if (!read_trace(files[0], a) || !read_trace(files[1], b)) return 2;
+        return report_divergence(a, b);
+    }
+
+    //показатели Ляпунова сцены (по умолчанию двойной маятник) шагом с касательными
+    int lyapunov_mode(const CliArgs& args) {
+        PhysicsEngine engine = make_engine(args);
+        if (engine.getSolverMode() != SolverMode::GaussSeidel) {
+            std::cerr << "--lyapunov needs the Gauss-Seidel solver" << std::endl;
+            return 2;
+        }
+        build_scene(engine, args.get("--scene", "double"), static_cast<size_t>(args.getInt("--size", 8)));
+        TangentStepper<2> tangent(engine);
+        tangent.setRenormalizeInterval(static_cast<size_t>(args.getInt("--renormalize-every", 10)));
+        tangent.randomizeTangents(static_cast<std::uint64_t>(args.getInt("--seed", 1)));
+
+        long long steps = args.getInt("--steps", 20000);
+        long long report = std::max(1LL, steps / 10);
+        for (long long i = 1; i <= steps; i++) {
+            tangent.step();
+            if (i % report == 0 || i == steps) {
+                auto l = tangent.lyapunovExponents();
+                std::cout << "t=" << engine.getTime() << "  lambda1=" << l[0] << "  lambda2=" << l[1] << std::endl;
+            }
+        }
+        return 0;
+    }
+
+    //прогон сцены с диагностикой после каждого шага; выход за порог останавливает прогон
+    int monitor_mode(const CliArgs& args) {
+        PhysicsEngine engine = make_engine(args);
+        build_scene(engine, args.get("--scene", "chain"), static_cast<size_t>(args.getInt("--size", 64)));
+        engine.enableDiagnostics(static_cast<size_t>(std::max(1LL, args.getInt("--history", 1024))),
+                                 static_cast<size_t>(std::max(1LL, args.getInt("--diagnostics-every", 1))));
+        Diagnostics& diag = engine.getDiagnostics();
+
+        const std::pair<const char*, DiagnosticMetric> limits[] = {
+            {"--max-energy-drift", DiagnosticMetric::EnergyDrift},
+            {"--max-momentum", DiagnosticMetric::Momentum},
+            {"--max-stretch", DiagnosticMetric::MaxStretch},
+            {"--max-rms-stretch", DiagnosticMetric::RmsStretch},
+        };
+        for (const auto& [key, metric] : limits) {
+            if (!args.has(key)) continue;
+            double bound = args.getDouble(key, 0.0);
+            diag.addThreshold(metric, bound, [bound](const DiagnosticsSample& s, DiagnosticMetric m, double v) {
+                std::cerr << "step " << s.step << ": " << metricName(m) << " " << v << " exceeds " << bound
+                          << std::endl;
+            });
+        }
+
+        long long steps = args.getInt("--steps", 1000);
+        long long report = std::max(1LL, args.getInt("--report-every", std::max(1LL, steps / 10)));
+        auto print = [](const DiagnosticsSample& s) {
+            std::cout << "step " << s.step << "  E=" << s.total << " (K=" << s.kinetic << ")  drift=" << s.energy_drift
+                      << "  |p|=" << leight(s.momentum) << "  stretch max=" << s.max_stretch
+                      << " rms=" << s.rms_stretch << std::endl;
+        };
+        for (long long i = 1; i <= steps && !diag.tripped(); i++) {
+            engine.step();
+            if (i % report == 0 && diag.size() > 0) print(diag.latest());
+        }
+
+        std::string csv = args.get("--csv");
+        if (!csv.empty()) {
+            std::ofstream out(csv);
+            if (!out) {
+                std::cerr << "Cannot write " << csv << std::endl;
+                return 2;
+            }
+            out << "step,time,kinetic,potential,total,energy_drift,momentum_x,momentum_y,max_stretch,rms_stretch\n";
+            for (size_t k = 0; k < diag.size(); k++) {
+                const DiagnosticsSample& s = diag.at(k);
+                out << s.step << "," << s.time << "," << s.kinetic << "," << s.potential << "," << s.total << ","
+                    << s.energy_drift << "," << s.momentum.x << "," << s.momentum.y << "," << s.max_stretch << ","
+                    << s.rms_stretch << "\n";
+            }
+        }
+        if (diag.tripped()) {
+            std::cerr << "Stopped at step " << engine.getStepCount() << std::endl;
+            return 3;
+        }
+        return 0;
+    }
+
+    int determinism_mode(const CliArgs& args) {
+        PhysicsEngine serial = make_engine(args);
+        serial.setThreadCount(1);
+        PhysicsEngine parallel = make_engine(args);
+
+        std::cout << "Comparing 1 thread against " << parallel.getThreadCount() << " threads" << std::endl;
+        return report_divergence(run_trace(serial, args), run_trace(parallel, args));
+    }
+}
+
+CliArgs::CliArgs(int argc, char* argv[]) : args(argv + 1, argv + argc) {}
+
+bool CliArgs::has(const std::string& key) const {
+    for (const auto& a : args) {
+        if (a == key) return true;
+    }
+    return false;
+}
+
+std::vector<std::string> CliArgs::values(const std::string& key) const {
+    std::vector<std::string> out;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] != key) continue;
+        for (size_t j = i + 1; j < args.size() && args[j].rfind("--", 0) != 0; j++) {
+            out.push_back(args[j]);
+        }
+        break;
+    }
+    return out;
+}
+
+std::string CliArgs::get(const std::string& key, const std::string& def) const {
+    std::vector<std::string> v = values(key);
+    return v.empty() ? def : v.front();
+}
+
+double CliArgs::getDouble(const std::string& key, double def) const {
+    std::string v = get(key);
+    try {
+        return v.empty() ? def : std::stod(v);
+    } catch (...) {
+        return def;
+    }
+}
+
+long long CliArgs::getInt(const std::string& key, long long def) const {
+    std::string v = get(key);
+    try {
+        return v.empty() ? def : std::stoll(v);
+    } catch (...) {
+        return def;
+    }
+}
+
+SceneRange build_scene(PhysicsEngine& engine, const std::string& name, size_t size) {
+    Vec2d pivot{1000.0, 500.0};
+    if (name == "rope") {
+        return engine.createRope(pivot, pivot + Vec2d{800.0, 0.0}, size, 10.0);
+    }
+    if (name == "cloth") {
+        return engine.createClothGrid(pivot, size, size, 10.0, 1.0);
+    }
+    if (name == "tree") {
+        return engine.createBinaryTree(pivot, size, 40.0, 1.0, 400.0);
+    }
+    if (name == "array") {
+        return engine.createPendulumArray(Vec2d{0.0, 500.0}, Vec2d{20.0, 0.0}, size, 2, 100.0, 1.0, 1.0);
+    }
+    if (name == "double") {
+        SceneRange range;
+        range.first_particle = engine.getParticleCount();
+        range.first_constraint = engine.getConstraintCount();
+        engine.createDoublePendulum(pivot, 200.0, 200.0, 1.0, 1.0);
+        range.particle_count = 3;
+        range.constraint_count = 2;
+        return range;
+    }
+    //chain: начинаем горизонтально, чтобы сцена сразу двигалась
+    return engine.createChain(pivot, size, 10.0, 1.0, Vec2d{1.0, 0.0});
+}
+
+bool run_headless(int argc, char* argv[], int& exit_code) {
+    CliArgs args(argc, argv);
+
+    if (args.has("--trace")) {
+        exit_code = trace_mode(args);
+        return true;
+    }
+    if (args.has("--compare")) {
+        exit_code = compare_mode(args);
+        return true;
+    }
+    if (args.has("--bench")) {
+        exit_code = bench_mode(args);
+        return true;
+    }
+    if (args.has("--lyapunov")) {
+        exit_code = lyapunov_mode(args);
+        return true;
+    }
+    if (args.has("--monitor")) {
+        exit_code = monitor_mode(args);
+        return true;
+    }
+    if (args.has("--sweep")) {
+        exit_code = sweep_mode(args, argv[0]);
+        return true;
+    }
+    if (args.has("--sweep-worker")) {
+        exit_code = sweep_worker_mode(args);
+        return true;
+    }
+    if (args.has("--determinism-check")) {
+        exit_code = determinism_mode(args);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,120 @@
+#include "../include/jacobi_solver.h"
+#include "../include/physics_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    void for_range(TaskScheduler* scheduler, size_t n, size_t grain,
+                   const std::function<void(size_t, size_t)>& fn) {
+        if (scheduler && n > grain) {
+            scheduler->parallel_for(0, n, grain, fn);
+        } else {
+            fn(0, n);
+        }
+    }
+}
+
+void JacobiSolver::build(const std::vector<Particle>& particles, const std::vector<Constraint>& constraints) {
+    auto weight = [&particles](size_t i) {
+        const Particle& p = particles[i];
+        return p.fixed ? 0.0 : p.inv_mass;
+    };
+
+    i1.clear();
+    i2.clear();
+    rest.clear();
+    floor.clear();
+    w1.clear();
+    w2.clear();
+    for (const auto& c : constraints) {
+        double a = weight(c.particle1_idx);
+        double b = weight(c.particle2_idx);
+        double total = a + b;
+        if (total < 1e-9 || c.stiffness < 1e-9) continue;
+        i1.push_back(c.particle1_idx);
+        i2.push_back(c.particle2_idx);
+        rest.push_back(c.target_length);
+        floor.push_back(c.kind == ConstraintKind::Rope ? 0.0 : -std::numeric_limits<double>::infinity());
+        w1.push_back(a / total * c.stiffness);
+        w2.push_back(b / total * c.stiffness);
+    }
+    size_t m = rest.size();
+    dx.assign(m, 0.0);
+    dy.assign(m, 0.0);
+
+    //у каждой частицы - список её связей; закреплённая сторона не двигается и не считается
+    size_t n = particles.size();
+    incident_start.assign(n + 1, 0);
+    for (size_t k = 0; k < m; k++) {
+        if (w1[k] > 0.0) incident_start[i1[k] + 1]++;
+        if (w2[k] > 0.0) incident_start[i2[k] + 1]++;
+    }
+    for (size_t p = 0; p < n; p++) {
+        incident_start[p + 1] += incident_start[p];
+    }
+    incident.resize(incident_start[n]);
+    incident_w.resize(incident_start[n]);
+    std::vector<size_t> cursor(incident_start.begin(), incident_start.end() - 1);
+    for (size_t k = 0; k < m; k++) {
+        if (w1[k] > 0.0) {
+            incident[cursor[i1[k]]] = k;
+            incident_w[cursor[i1[k]]++] = w1[k];
+        }
+        if (w2[k] > 0.0) {
+            incident[cursor[i2[k]]] = k;
+            incident_w[cursor[i2[k]]++] = -w2[k];
+        }
+    }
+    inv_count.resize(n);
+    for (size_t p = 0; p < n; p++) {
+        size_t count = incident_start[p + 1] - incident_start[p];
+        inv_count[p] = count ? 1.0 / double(count) : 0.0;
+    }
+}
+
+void JacobiSolver::iterate(std::vector<Particle>& particles, double omega, TaskScheduler* scheduler, size_t grain) {
+    size_t m = rest.size();
+    if (m == 0) return;
+
+    //поправки связей: сначала сбор разностей позиций, потом чистая арифметика
+    //по столбцам без зависимостей между соседними связями
+    for_range(scheduler, m, grain, [&](size_t b, size_t e) {
+        for (size_t k = b; k < e; k++) {
+            const Vec2d& x1 = particles[i1[k]].predicted_position;
+            const Vec2d& x2 = particles[i2[k]].predicted_position;
+            dx[k] = x2.x - x1.x;
+            dy[k] = x2.y - x1.y;
+        }
+        double* __restrict px = dx.data();
+        double* __restrict py = dy.data();
+        const double* __restrict len0 = rest.data();
+        const double* __restrict lo = floor.data();
+        for (size_t k = b; k < e; k++) {
+            double len = std::sqrt(px[k] * px[k] + py[k] * py[k]);
+            double err = std::max(len - len0[k], lo[k]);
+            //деление без условия (вырожденную связь обнуляем выбором), иначе цикл не векторизуется
+            double s = err / std::max(len, 1e-9);
+            s = len > 1e-9 ? s : 0.0;
+            px[k] *= s;
+            py[k] *= s;
+        }
+    });
+
+    //сбор поправок по частицам в фиксированном порядке их связей
+    for_range(scheduler, particles.size(), grain, [&](size_t b, size_t e) {
+        for (size_t p = b; p < e; p++) {
+            size_t first = incident_start[p];
+            size_t last = incident_start[p + 1];
+            if (first == last) continue;
+            double sx = 0.0, sy = 0.0;
+            for (size_t j = first; j < last; j++) {
+                size_t k = incident[j];
+                sx += dx[k] * incident_w[j];
+                sy += dy[k] * incident_w[j];
+            }
+            double scale = omega * inv_count[p];
+            particles[p].predicted_position += Vec2d{sx * scale, sy * scale};
+        }
+    });
+}
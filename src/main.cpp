@@ -1,19 +1,85 @@
 #include <SFML/Graphics.hpp>
 #include <iostream>
+#include <memory>
+#include <string>
 #include "../include/physics_engine.h"
+#include "../include/physics_thread.h"
+#include "../include/headless.h"
+#include "../include/trace.h"
+#include "../include/quality_controller.h"
 #include "../include/pendulum.h"
 #include "../include/Modal_win.h"
+#include "../include/ui_resources.h"
 #include "../include/visual_config.h"
 
-int main() {
+int main(int argc, char* argv[]) {
 
+    //безоконные режимы (следы хэшей, сравнение прогонов)
+    int exit_code = 0;
+    if (run_headless(argc, argv, exit_code)) {
+        return exit_code;
+    }
+
+    //--physics-thread: движок шагает на своём потоке, отрисовка читает готовые кадры
+    //--trace-events <file>: куда писать трассу кадров (T - вкл/выкл, F - записать сейчас)
+    //--frame-budget <ms>: сколько физика может занимать в кадре (итерации и подшаги
+    //подбираются сами); --fixed-quality - всегда 10 итераций, шаг 0.016
+    //--font <файл|папка>: где искать шрифт интерфейса раньше системных
+    bool use_physics_thread = false;
+    std::string trace_path = "pendulum_trace.json";
+    double frame_budget = 8.0;
+    bool fixed_quality = false;
+    UiResources ui;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--physics-thread") use_physics_thread = true;
+        if (std::string(argv[i]) == "--fixed-quality") fixed_quality = true;
+        if (std::string(argv[i]) == "--frame-budget" && i + 1 < argc) {
+            try {
+                frame_budget = std::stod(argv[++i]);
+            } catch (...) {
+                std::cerr << "Bad --frame-budget, using " << frame_budget << " ms" << std::endl;
+            }
+        }
+        if (std::string(argv[i]) == "--font" && i + 1 < argc) {
+            ui.addFontPath(argv[++i]);
+        }
+        if (std::string(argv[i]) == "--trace-events" && i + 1 < argc) {
+            trace_path = argv[++i];
+            Trace::setEnabled(true);
+        }
+    }
+    Trace::setThreadName("main");
     
     sf::RenderWindow window(sf::VideoMode({Config::WINDOW_WIDTH, Config::WINDOW_HEIGHT}), "Pendulum");
-    window.setFramerateLimit(60);
+    const unsigned frame_rate = 60;
+    window.setFramerateLimit(frame_rate);
     
     PhysicsEngine engine(Vec2d(0, 300.0), 0.016, 10, 0);
+    engine.setThreadCount(0);
+    //шаг раз в кадр: воркеры крутятся чуть дольше кадра и не засыпают между шагами
+    engine.setThreadSpinTime(std::chrono::microseconds(1250000 / frame_rate));
+    //снимок каждые 10 шагов в 16 МБ: у сцены из тысячи частиц - около 80 секунд истории
+    engine.enableSnapshots(16 << 20, 10);
+    //края окна - стенки, частицы сталкиваются с ними своим радиусом
+    engine.setCollisionRadius(Config::RADIUS);
+    engine.getColliders().addBox(Vec2d(Config::WINDOW_WIDTH * 0.5, Config::WINDOW_HEIGHT * 0.5),
+                                 Vec2d(Config::WINDOW_WIDTH * 0.5, Config::WINDOW_HEIGHT * 0.5));
     Pendulum pendulum(engine, window);
-    ModalWindow dialog(engine);
+    //шрифт грузится, пока рисуются первые кадры; диалог создаётся при первом открытии
+    ui.startLoading();
+    std::unique_ptr<ModalWindow> dialog;
+
+    //работа физики под бюджет кадра; на нижних ступенях и круги проще
+    QualityController quality(engine, 0.016);
+    quality.setBudget(frame_budget);
+    quality.setMinLevel(1);
+    quality.setAdaptive(!fixed_quality);
+    quality.setLevelListener([&quality, &pendulum](size_t level) {
+        const QualityLevel& q = quality.currentLevel();
+        std::cout << "Quality level " << level << ": " << q.substeps << " substeps x "
+                  << q.iterations << " iterations (" << quality.averageCost() << " ms)" << std::endl;
+        pendulum.set_detail(level >= 2);
+    });
     
     
     pendulum.create_firs_part(
@@ -21,6 +87,35 @@ int main() {
                      Config::WINDOW_HEIGHT * 0.25f),
          0, 0, 0, 0, 1);
 
+    std::unique_ptr<PhysicsThread> physics_thread;
+    if (!use_physics_thread) {
+        engine.setReorderListener([&pendulum](const ReorderMap& map) { pendulum.remap_particles(map); });
+    }
+    if (use_physics_thread) {
+        physics_thread = std::make_unique<PhysicsThread>(engine);
+        physics_thread->start();
+    }
+    auto open_dialog = [&]() -> ModalWindow& {
+        if (!dialog) {
+            dialog = std::make_unique<ModalWindow>(engine, ui);
+            if (physics_thread) {
+                dialog->set_particle_source([&physics_thread](size_t i) {
+                    const EngineSnapshot& s = physics_thread->latest();
+                    Particle p(s.positions[i]);
+                    p.velocity = s.velocities[i];
+                    p.inv_mass = s.inv_mass[i];
+                    return p;
+                });
+            }
+        }
+        return *dialog;
+    };
+    //диалог по центру окна
+    const sf::Vector2f dialog_pos = {
+        (Config::WINDOW_WIDTH - Config::MODAL_WIDTH) * 0.5f,
+        (Config::WINDOW_HEIGHT - Config::MODAL_HEIGHT) * 0.5f
+    };
+
     bool is_dragging = false;
     size_t drag_from_idx = 0;
     sf::Vector2f drag_start_pos;
@@ -30,148 +125,212 @@ int main() {
     bool is_changing = false;
     
     while (window.isOpen()) {
-        while (auto event = window.pollEvent()) {
-            if (dialog.is_visible()) {
-                if (dialog.handle_event(*event)) {
-                    continue;
+        PENDULUM_TRACE_ZONE("frame");
+        {
+            PENDULUM_TRACE_ZONE("pollEvent");
+            while (auto event = window.pollEvent()) {
+                if (dialog && dialog->is_visible()) {
+                    if (dialog->handle_event(*event)) {
+                        continue;
+                    }
                 }
-            }
 
-            if (event->is<sf::Event::Closed>()) {
-                window.close();
-            }
-            
-            if (auto* key = event->getIf<sf::Event::KeyPressed>()) {
-                if (key->scancode == sf::Keyboard::Scan::Space) {
-                    is_paused = !is_paused;
-                }
-                else if (key->scancode == sf::Keyboard::Scan::Escape) {
+                if (event->is<sf::Event::Closed>()) {
                     window.close();
                 }
-                else if (key->scancode == sf::Keyboard::Scan::CapsLock) {
-                    is_changing = !is_changing;
+            
+                if (auto* key = event->getIf<sf::Event::KeyPressed>()) {
+                    if (key->scancode == sf::Keyboard::Scan::Space) {
+                        is_paused = !is_paused;
+                        if (physics_thread) physics_thread->setPaused(is_paused);
+                    }
+                    else if (key->scancode == sf::Keyboard::Scan::Escape) {
+                        window.close();
+                    }
+                    else if (key->scancode == sf::Keyboard::Scan::CapsLock) {
+                        is_changing = !is_changing;
+                    }
+                    else if (key->scancode == sf::Keyboard::Scan::T) {
+                        Trace::setEnabled(!Trace::enabled());
+                        std::cout << "Tracing " << (Trace::enabled() ? "on" : "off") << std::endl;
+                    }
+                    else if (key->scancode == sf::Keyboard::Scan::F) {
+                        if (Trace::writeJson(trace_path)) {
+                            std::cout << "Trace written to " << trace_path << std::endl;
+                        }
+                    }
+                    //на паузе: стрелки - шаг назад/вперёд, с Shift - сразу на 10 шагов
+                    else if (is_paused && (key->scancode == sf::Keyboard::Scan::Left ||
+                                           key->scancode == sf::Keyboard::Scan::Right)) {
+                        long long delta = key->shift ? 10 : 1;
+                        if (key->scancode == sf::Keyboard::Scan::Left) delta = -delta;
+                        if (physics_thread) {
+                            physics_thread->post([delta](PhysicsEngine& eng) { eng.seekRelative(delta); });
+                        } else if (!pendulum.scrub(delta)) {
+                            std::cout << "No snapshot to rewind to" << std::endl;
+                        }
+                    }
                 }
-            }
 
-            if (is_paused) {
-                if(is_changing){
-                    if (auto* mouse_release = event->getIf<sf::Event::MouseButtonReleased>()){
-                        if(!is_dragging && mouse_release->button == sf::Mouse::Button::Left){
+                if (is_paused) {
+                    if(is_changing){
+                        if (auto* mouse_release = event->getIf<sf::Event::MouseButtonReleased>()){
+                            if(!is_dragging && mouse_release->button == sf::Mouse::Button::Left){
                             
-                            sf::Vector2f mouse_pos = window.mapPixelToCoords(mouse_release->position);
-                            const auto& circles = pendulum.get_circles();
+                                sf::Vector2f mouse_pos = window.mapPixelToCoords(mouse_release->position);
+                                const auto& circles = pendulum.get_circles();
 
-                           sf::Vector2f screen_pos = {
-                                (Config::WINDOW_WIDTH - dialog.get_size().x) * 0.5f,
-                                (Config::WINDOW_HEIGHT - dialog.get_size().y) * 0.5f
-                            };
-
-                            for (size_t i = 0; i < circles.size(); i++) {
-                                if (circles[i].getGlobalBounds().contains(mouse_pos)) {
+                                for (size_t i = 0; i < circles.size(); i++) {
+                                    if (circles[i].getGlobalBounds().contains(mouse_pos)) {
                                     
-                                    dialog.show(0, i, screen_pos, 
-                                    [&pendulum, i]
-                                    (float mass, float speed, bool direction_right, bool change, bool remove) {
-                                        if (change && mass > 0){
-                                            pendulum.change_state(i, mass, (direction_right ? -speed: speed));
-                                            std::cout << " Pendulum changed:" << std::endl;
-                                            std::cout << "  Mass: " << mass << std::endl;
-                                            std::cout << "  Speed: " << speed << std::endl;
-                                            std::cout << "  Direction: " << (direction_right ? "Right" : "Left") << std::endl;
+                                        open_dialog().show(0, i, dialog_pos, 
+                                        [&pendulum, &physics_thread, i]
+                                        (float mass, float speed, bool direction_right, bool change, bool remove) {
+                                            double velosity = direction_right ? -speed: speed;
+                                            if (change && mass > 0){
+                                                if (physics_thread) {
+                                                    physics_thread->post([i, mass, velosity](PhysicsEngine& eng) {
+                                                        Pendulum::apply_state(eng, i, mass, velosity);
+                                                    });
+                                                } else {
+                                                    pendulum.change_state(i, mass, velosity);
+                                                }
+                                                std::cout << " Pendulum changed:" << std::endl;
+                                                std::cout << "  Mass: " << mass << std::endl;
+                                                std::cout << "  Speed: " << speed << std::endl;
+                                                std::cout << "  Direction: " << (direction_right ? "Right" : "Left") << std::endl;
 
-                                        } else if(remove){
-                                            pendulum.change_state(i, mass, (direction_right ? -speed: speed), true);
-                                            std::cout << "Pendulum was delet"<< std::endl;
+                                            } else if(remove){
+                                                if (physics_thread) {
+                                                    physics_thread->post([i](PhysicsEngine& eng) { eng.edits().removeParticle(i); });
+                                                } else {
+                                                    pendulum.change_state(i, mass, velosity, true);
+                                                }
+                                                std::cout << "Pendulum was delet"<< std::endl;
 
-                                        } 
-                                        else{
-                                            std::cout << "Change was canceled" << std::endl;
-                                        }
-                                    });
-                                    break;
+                                            } 
+                                            else{
+                                                std::cout << "Change was canceled" << std::endl;
+                                            }
+                                        });
+                                        break;
                                     
+                                    }
                                 }
-                            }
 
+                            }
                         }
-                    }
-                }else if (auto* mouse_press = event->getIf<sf::Event::MouseButtonPressed>()) {
-
-                    if (mouse_press->button == sf::Mouse::Button::Left) {
-                        sf::Vector2f mouse_pos = window.mapPixelToCoords(mouse_press->position);
-
-                        const auto& circles = pendulum.get_circles();
-                        for (size_t i = 0; i < circles.size(); i++) {
-                            if (circles[i].getGlobalBounds().contains(mouse_pos)) {
-                                is_dragging = true;
-                                drag_from_idx = i;
-                                drag_start_pos = circles[i].getPosition();
-                                drag_current_pos = mouse_pos;
-                                break;
+                    }else if (auto* mouse_press = event->getIf<sf::Event::MouseButtonPressed>()) {
+
+                        if (mouse_press->button == sf::Mouse::Button::Left) {
+                            sf::Vector2f mouse_pos = window.mapPixelToCoords(mouse_press->position);
+
+                            const auto& circles = pendulum.get_circles();
+                            for (size_t i = 0; i < circles.size(); i++) {
+                                if (circles[i].getGlobalBounds().contains(mouse_pos)) {
+                                    is_dragging = true;
+                                    drag_from_idx = i;
+                                    drag_start_pos = circles[i].getPosition();
+                                    drag_current_pos = mouse_pos;
+                                    break;
+                                }
                             }
                         }
                     }
-                }
-                else if (auto* mouse_move = event->getIf<sf::Event::MouseMoved>()) {
-                    if (is_dragging) {
-                        drag_current_pos = window.mapPixelToCoords(mouse_move->position);
+                    else if (auto* mouse_move = event->getIf<sf::Event::MouseMoved>()) {
+                        if (is_dragging) {
+                            drag_current_pos = window.mapPixelToCoords(mouse_move->position);
+                        }
                     }
-                }
-                else if (auto* mouse_release = event->getIf<sf::Event::MouseButtonReleased>()) {
-                    if (is_dragging && mouse_release->button == sf::Mouse::Button::Left) {
-                        is_dragging = false;
-                        
-                        sf::Vector2f end_pos = window.mapPixelToCoords(mouse_release->position);
+                    else if (auto* mouse_release = event->getIf<sf::Event::MouseButtonReleased>()) {
+                        if (is_dragging && mouse_release->button == sf::Mouse::Button::Left) {
+                            is_dragging = false;
                         
-                        sf::Vector2f screen_pos = {
-                            (Config::WINDOW_WIDTH - dialog.get_size().x) * 0.5f,
-                            (Config::WINDOW_HEIGHT - dialog.get_size().y) * 0.5f
-                        };
-
-                        float length = std::sqrt(
-                            std::pow(end_pos.x - drag_start_pos.x, 2) +
-                            std::pow(end_pos.y - drag_start_pos.y, 2)
-                        );
+                            sf::Vector2f end_pos = window.mapPixelToCoords(mouse_release->position);
+
+                            float length = std::sqrt(
+                                std::pow(end_pos.x - drag_start_pos.x, 2) +
+                                std::pow(end_pos.y - drag_start_pos.y, 2)
+                            );
                         
-                        if (length > 30.0f) {
-                            dialog.show(1,  -1, screen_pos, 
-                                [&pendulum, drag_from_idx, end_pos, length]
-                                (float mass, float speed, bool direction_right, bool create, bool remove) {
-                                    if (create && mass > 0){
-                                        pendulum.create_pendulum(end_pos, drag_from_idx, length, mass, (direction_right ? -speed: speed));
-                                        std::cout << " Pendulum created:" << std::endl;
-                                        std::cout << "  Mass: " << mass << std::endl;
-                                        std::cout << "  Speed: " << speed << std::endl;
-                                        std::cout << "  Direction: " << (direction_right ? "Right" : "Left") << std::endl;
-                                        std::cout << "  Leight: " << length << std::endl;
-                                    } else {
-                                        std::cout << "Creation was canceled" << std::endl;
-                                    }
-                                });
-                        } else {
-                            std::cout << "Too little" << std::endl;
+                            if (length > 30.0f) {
+                                open_dialog().show(1,  -1, dialog_pos, 
+                                    [&pendulum, &physics_thread, drag_from_idx, end_pos, length]
+                                    (float mass, float speed, bool direction_right, bool create, bool remove) {
+                                        if (create && mass > 0){
+                                            double velosity = direction_right ? -speed: speed;
+                                            if (physics_thread) {
+                                                Vec2d pos{end_pos.x, end_pos.y};
+                                                physics_thread->post([pos, drag_from_idx, length, mass, velosity](PhysicsEngine& eng) {
+                                                    Pendulum::spawn_particle(eng, pos, drag_from_idx, length, mass, velosity);
+                                                });
+                                            } else {
+                                                pendulum.create_pendulum(end_pos, drag_from_idx, length, mass, velosity);
+                                            }
+                                            std::cout << " Pendulum created:" << std::endl;
+                                            std::cout << "  Mass: " << mass << std::endl;
+                                            std::cout << "  Speed: " << speed << std::endl;
+                                            std::cout << "  Direction: " << (direction_right ? "Right" : "Left") << std::endl;
+                                            std::cout << "  Leight: " << length << std::endl;
+                                        } else {
+                                            std::cout << "Creation was canceled" << std::endl;
+                                        }
+                                    });
+                            } else {
+                                std::cout << "Too little" << std::endl;
+                            }
                         }
                     }
                 }
             }
         }
         
-        if (!is_paused) {
-            engine.step();
+        if (physics_thread) {
+            PENDULUM_TRACE_ZONE("update_animation");
+            pendulum.sync_from_snapshot(physics_thread->latest());
+        }
+        else if (!is_paused) {
+            {
+                PENDULUM_TRACE_ZONE("engine.step");
+                quality.advance();
+            }
+            PENDULUM_TRACE_ZONE("update_animation");
+            pendulum.update_animation();
+        }
+        else if (engine.commitEdits()) {
+            //на паузе правки кадра применяем сами, шаг их не заберёт
+            PENDULUM_TRACE_ZONE("update_animation");
             pendulum.update_animation();
         }
         window.clear(sf::Color(20, 20, 30));
         
 
-        pendulum.draw_all();
+        {
+            PENDULUM_TRACE_ZONE("draw_all");
+            pendulum.draw_all();
+        }
     
         if (is_dragging) {
             pendulum.show_drag_preview(drag_current_pos, drag_from_idx);
         }
         
-        dialog.draw(window);
+        {
+            PENDULUM_TRACE_ZONE("ModalWindow::draw");
+            if (dialog) dialog->draw(window);
+        }
         
-        window.display();
+        {
+            PENDULUM_TRACE_ZONE("window.display");
+            window.display();
+        }
+        //уже показанный кадр не ждёт ни шрифта, ни запекания глифов
+        ui.poll();
+    }
+    if (physics_thread) physics_thread->stop();
+
+    //всё, что успели записать, сохраняем при выходе
+    if (Trace::eventCount() > 0 && Trace::writeJson(trace_path)) {
+        std::cout << "Trace written to " << trace_path << std::endl;
     }
     return 0;
 }
\ No newline at end of file
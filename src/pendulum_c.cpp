@@ -0,0 +1,193 @@
+#include "../include/pendulum_c.h"
+#include "../include/physics_engine.h"
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+struct pendulum_engine {
+    PhysicsEngine engine;
+};
+
+namespace {
+    //view отдаёт указатели внутрь Particle, поэтому раскладка должна быть известна
+    static_assert(std::is_standard_layout<Particle>::value, "Particle layout must be standard");
+    static_assert(sizeof(Vec2d) == 2 * sizeof(double), "Vec2d must be two packed doubles");
+
+    thread_local std::string last_error;
+
+    //исключения не должны пересекать границу C
+    template <class Fn>
+    int guarded(Fn&& fn) {
+        try {
+            fn();
+            last_error.clear();
+            return PENDULUM_OK;
+        } catch (const std::out_of_range& e) {
+            last_error = e.what();
+            return PENDULUM_ERROR_OUT_OF_RANGE;
+        } catch (const std::invalid_argument& e) {
+            last_error = e.what();
+            return PENDULUM_ERROR_INVALID_ARGUMENT;
+        } catch (const std::exception& e) {
+            last_error = e.what();
+            return PENDULUM_ERROR_INTERNAL;
+        } catch (...) {
+            last_error = "unknown error";
+            return PENDULUM_ERROR_INTERNAL;
+        }
+    }
+
+    int null_argument(const char* what) {
+        last_error = what;
+        return PENDULUM_ERROR_INVALID_ARGUMENT;
+    }
+
+    void fill_vec2(PhysicsEngine& engine, size_t member, pendulum_vec2_view* out) {
+        size_t n = engine.getParticleCount();
+        char* base = n ? reinterpret_cast<char*>(engine.particleData()) + member : nullptr;
+        out->x = reinterpret_cast<double*>(base);
+        out->y = base ? reinterpret_cast<double*>(base + offsetof(Vec2d, y)) : nullptr;
+        out->count = n;
+        out->stride = sizeof(Particle);
+    }
+}
+
+extern "C" {
+
+int pendulum_api_version(void) { return PENDULUM_C_API_VERSION; }
+
+const char* pendulum_last_error(void) { return last_error.c_str(); }
+
+pendulum_engine* pendulum_create(double gravity_x, double gravity_y, double dt, int iterations, double damping) {
+    pendulum_engine* handle = nullptr;
+    guarded([&] {
+        if (dt <= 0.0 || iterations <= 0) throw std::invalid_argument("dt and iterations must be positive");
+        handle = new pendulum_engine{PhysicsEngine(Vec2d(gravity_x, gravity_y), dt, iterations, damping)};
+    });
+    return handle;
+}
+
+void pendulum_destroy(pendulum_engine* engine) { delete engine; }
+
+int pendulum_clear(pendulum_engine* engine) {
+    if (!engine) return null_argument("engine is null");
+    return guarded([&] { engine->engine.clear(); });
+}
+
+int pendulum_add_particles(pendulum_engine* engine, const double* xy, const double* masses, const uint8_t* fixed,
+                           size_t count, size_t* first_index) {
+    if (!engine) return null_argument("engine is null");
+    return guarded([&] {
+        if (count > 0 && !xy) throw std::invalid_argument("positions are null");
+        SceneRange range = engine->engine.addParticles(reinterpret_cast<const Vec2d*>(xy), count, masses, fixed);
+        if (first_index) *first_index = range.first_particle;
+    });
+}
+
+int pendulum_add_constraints(pendulum_engine* engine, const size_t* pairs, const double* lengths,
+                             const double* stiffness, size_t count) {
+    if (!engine) return null_argument("engine is null");
+    return guarded([&] {
+        if (count > 0 && !pairs) throw std::invalid_argument("pairs are null");
+        engine->engine.addConstraints(pairs, count, lengths, stiffness);
+    });
+}
+
+int pendulum_step(pendulum_engine* engine, size_t steps) {
+    if (!engine) return null_argument("engine is null");
+    return guarded([&] {
+        for (size_t i = 0; i < steps; i++) {
+            engine->engine.step();
+        }
+    });
+}
+
+int pendulum_set_gravity(pendulum_engine* engine, double x, double y) {
+    if (!engine) return null_argument("engine is null");
+    engine->engine.setGravity(Vec2d(x, y));
+    return PENDULUM_OK;
+}
+
+int pendulum_set_time_step(pendulum_engine* engine, double dt) {
+    if (!engine) return null_argument("engine is null");
+    return guarded([&] {
+        if (dt <= 0.0) throw std::invalid_argument("dt must be positive");
+        engine->engine.setTimeStep(dt);
+    });
+}
+
+int pendulum_set_iterations(pendulum_engine* engine, int iterations) {
+    if (!engine) return null_argument("engine is null");
+    return guarded([&] {
+        if (iterations <= 0) throw std::invalid_argument("iterations must be positive");
+        engine->engine.setSolverIterations(iterations);
+    });
+}
+
+int pendulum_set_damping(pendulum_engine* engine, double damping) {
+    if (!engine) return null_argument("engine is null");
+    engine->engine.setDamping(damping);
+    return PENDULUM_OK;
+}
+
+int pendulum_set_thread_count(pendulum_engine* engine, unsigned threads) {
+    if (!engine) return null_argument("engine is null");
+    return guarded([&] { engine->engine.setThreadCount(threads); });
+}
+
+int pendulum_set_mass(pendulum_engine* engine, size_t index, double mass) {
+    if (!engine) return null_argument("engine is null");
+    return guarded([&] {
+        if (index >= engine->engine.getParticleCount()) throw std::out_of_range("Invalid particle index");
+        engine->engine.setParticleMass(index, mass);
+    });
+}
+
+size_t pendulum_particle_count(const pendulum_engine* engine) {
+    return engine ? engine->engine.getParticleCount() : 0;
+}
+
+size_t pendulum_constraint_count(const pendulum_engine* engine) {
+    return engine ? engine->engine.getConstraintCount() : 0;
+}
+
+double pendulum_time(const pendulum_engine* engine) {
+    return engine ? engine->engine.getTime() : 0.0;
+}
+
+uint64_t pendulum_step_count(const pendulum_engine* engine) {
+    return engine ? engine->engine.getStepCount() : 0;
+}
+
+uint64_t pendulum_topology_version(const pendulum_engine* engine) {
+    return engine ? engine->engine.getTopologyVersion() : 0;
+}
+
+uint64_t pendulum_state_hash(const pendulum_engine* engine) {
+    return engine ? engine->engine.stateHash() : 0;
+}
+
+int pendulum_positions(pendulum_engine* engine, pendulum_vec2_view* out) {
+    if (!engine || !out) return null_argument("engine or view is null");
+    fill_vec2(engine->engine, offsetof(Particle, position), out);
+    return PENDULUM_OK;
+}
+
+int pendulum_velocities(pendulum_engine* engine, pendulum_vec2_view* out) {
+    if (!engine || !out) return null_argument("engine or view is null");
+    fill_vec2(engine->engine, offsetof(Particle, velocity), out);
+    return PENDULUM_OK;
+}
+
+int pendulum_inverse_masses(const pendulum_engine* engine, pendulum_const_scalar_view* out) {
+    if (!engine || !out) return null_argument("engine or view is null");
+    size_t n = engine->engine.getParticleCount();
+    const char* base = reinterpret_cast<const char*>(engine->engine.particleData());
+    out->data = n ? reinterpret_cast<const double*>(base + offsetof(Particle, inv_mass)) : nullptr;
+    out->count = n;
+    out->stride = sizeof(Particle);
+    return PENDULUM_OK;
+}
+
+}
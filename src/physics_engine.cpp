@@ -1,5 +1,16 @@
 #include "../include/physics_engine.h"
+#include "../include/state_hash.h"
+#include "../include/trace.h"
+#include <algorithm>
 #include <cmath>
+#include <numeric>
+
+namespace {
+    const double PI = 3.14159265358979323846;
+
+    //кусок частиц для хэша фиксирован, иначе хэш зависел бы от числа потоков
+    constexpr size_t HASH_CHUNK = 4096;
+}
 
 void Constraint::solve(std::vector<Particle>& particles) const {
     if (stiffness < 1e-9) return;
@@ -7,59 +18,24 @@ void Constraint::solve(std::vector<Particle>& particles) const {
     Particle& p1 = particles[particle1_idx];
     Particle& p2 = particles[particle2_idx];
     
-    if (p1.fixed && p2.fixed) return;
-    
-    //вектор между предсказанными позициями
-    Vec2d delta = p2.predicted_position - p1.predicted_position;
-    double current_len_sq = delta.x * delta.x + delta.y * delta.y;
-    
-    if (current_len_sq < 1e-18) return;
-    
-    double current_len = std::sqrt(current_len_sq);
-    double stretch = current_len - target_length;
-    
-    if (std::abs(stretch) < 1e-100) return;
-    
-    Vec2d direction = delta / current_len;
-    
-    double w1 = p1.inv_mass;
-    double w2 = p2.inv_mass;
+    double w1 = p1.fixed ? 0.0 : p1.inv_mass;
+    double w2 = p2.fixed ? 0.0 : p2.inv_mass;
     double total_weight = w1 + w2;
     
     if (total_weight < 1e-9) return;
     
-    //каоррекция позиций
-    double lambda = (stretch / total_weight) * stiffness;
-    
-    if (!p1.fixed) {
-        p1.predicted_position += direction * (lambda * w1);
-    }
-    if (!p2.fixed) {
-        p2.predicted_position -= direction * (lambda * w2);
-    }
+    //та же проекция, что в пакетах связей и в шаге с касательными
+    kernels::project_pair(p1.predicted_position, p2.predicted_position, target_length,
+                          w1 / total_weight * stiffness, w2 / total_weight * stiffness,
+                          kind == ConstraintKind::Rope);
 }
 
 void PhysicsEngine::removeParticle(size_t idx) {
     if (idx >= particles.size()) return;
-    
-    //удаляем связанные связи
-    auto it = constraints.begin();
-    while (it != constraints.end()) {
-        if (it->contains(idx)) {
-            it = constraints.erase(it);
-        } else {
-            ++it;
-        }
-    }
-    
-    //удаляем частицу
-    particles.erase(particles.begin() + idx);
-    
-    //обновляем индексы для потомков связей
-    for (auto& constraint : constraints) {
-        if (constraint.particle1_idx > idx) constraint.particle1_idx--;
-        if (constraint.particle2_idx > idx) constraint.particle2_idx--;
-    }
+    //та же пачка из одной правки: связи с частицей уходят, индексы сдвигаются за один проход
+    TopologyEdits edit;
+    edit.removeParticle(idx);
+    applyEdits(edit);
 }
 int PhysicsEngine::getConstraintCount_with(size_t idx){
     if (idx >= particles.size()) return 0;
@@ -91,43 +67,344 @@ void PhysicsEngine::createConstraint(size_t idx1, size_t idx2, double length, do
     }
     
     constraints.emplace_back(idx1, idx2, length, stiffness);
+    topology_version++;
+}
+
+void PhysicsEngine::createRopeConstraint(size_t idx1, size_t idx2, double max_length, double stiffness) {
+    createConstraint(idx1, idx2, max_length, stiffness);
+    constraints.back().kind = ConstraintKind::Rope;
+}
+
+void PhysicsEngine::createAngleConstraint(size_t a, size_t center, size_t b, double min_angle, double max_angle,
+                                          double stiffness) {
+    if (a >= particles.size() || center >= particles.size() || b >= particles.size()) {
+        throw std::out_of_range("Invalid particle index");
+    }
+    if (a == center || b == center || a == b) {
+        throw std::invalid_argument("Angle constraint needs three different particles");
+    }
+    if (min_angle < 0.0 || max_angle > PI || min_angle > max_angle) {
+        throw std::invalid_argument("Angle limits must satisfy 0 <= min <= max <= pi");
+    }
+    if (stiffness < 0.0 || stiffness > 1.0) {
+        throw std::invalid_argument("Stiffness must be between 0 and 1");
+    }
+    angle_constraints.push_back({a, center, b, min_angle, max_angle, stiffness});
+    topology_version++;
+}
+
+void PhysicsEngine::setThreadCount(unsigned n, bool pin_threads) {
+    if (n == 0) n = std::max(1u, std::thread::hardware_concurrency());
+    if (n == 1 && !pin_threads) {
+        scheduler.reset();
+        return;
+    }
+    scheduler = std::make_shared<TaskScheduler>(n, pin_threads);
+}
+
+void PhysicsEngine::forEachParticle(const std::function<void(size_t, size_t)>& fn) {
+    if (scheduler && particles.size() > parallel_grain) {
+        scheduler->parallel_for(0, particles.size(), parallel_grain, fn);
+    } else {
+        fn(0, particles.size());
+    }
+}
+
+size_t PhysicsEngine::workGrain(size_t n) const {
+    //на результат разбиение не влияет, только на балансировку
+    if (!scheduler) return std::max<size_t>(1, parallel_grain / 32);
+    return std::max<size_t>(1, n / (scheduler->concurrency() * 4));
+}
+
+std::uint64_t PhysicsEngine::stateHash() const {
+    size_t n = particles.size();
+    size_t chunks = (n + HASH_CHUNK - 1) / HASH_CHUNK;
+    std::vector<std::uint64_t> digests(chunks);
+
+    auto hash_chunks = [this, n, &digests](size_t b, size_t e) {
+        for (size_t c = b; c < e; c++) {
+            Xxh64 h;
+            size_t last = std::min(n, (c + 1) * HASH_CHUNK);
+            for (size_t i = c * HASH_CHUNK; i < last; i++) {
+                //ровно один 32-байтный блок XXH64 на частицу
+                const Particle& p = particles[i];
+                double record[4] = {p.position.x, p.position.y, p.velocity.x, p.velocity.y};
+                h.update(record, sizeof(record));
+            }
+            digests[c] = h.digest();
+        }
+    };
+    if (scheduler && chunks > 1) {
+        scheduler->parallel_for(0, chunks, 1, hash_chunks);
+    } else {
+        hash_chunks(0, chunks);
+    }
+
+    Xxh64 total;
+    std::uint64_t count = n;
+    total.update(&count, sizeof(count));
+    total.update(digests.data(), digests.size() * sizeof(std::uint64_t));
+    return total.digest();
+}
+
+void PhysicsEngine::prepareBatches() {
+    if (batches_version != topology_version || weights_dirty) {
+        batches.build(particles, constraints, angle_constraints);
+        batches_version = topology_version;
+        weights_dirty = false;
+        jacobi_ready = false;
+        cg_ready = false;
+    }
+}
+
+void PhysicsEngine::solveConstraints() {
+    prepareBatches();
+    if (colliders.empty()) {
+        solvePass(solver_iterations, true);
+        return;
+    }
+
+    //контакты - неравенства в том же цикле: после каждой итерации связей
+    //выталкиваем частицы из геометрии, последней стоит проекция контактов.
+    //Связи двигают частицы, поэтому контакты ищутся после первого прохода и
+    //заново после последнего: затянутую связями в препятствие частицу вытолкнет
+    for (int iter = 0; iter < solver_iterations; iter++) {
+        solvePass(1, iter == 0);
+        if (iter == 0 || iter == solver_iterations - 1) {
+            PENDULUM_TRACE_ZONE("step.contacts");
+            colliders.findContacts(particles, collision_radius, scheduler.get());
+        }
+        colliders.resolveContacts(particles, collision_radius, scheduler.get());
+    }
+}
+
+void PhysicsEngine::solvePass(int iterations, bool first) {
+    switch (solver_mode) {
+    case SolverMode::Jacobi:
+        solveJacobi(iterations);
+        break;
+    case SolverMode::ConjugateGradient:
+        solveCG(iterations, first);
+        break;
+    default:
+        solveIslands(iterations);
+        break;
+    }
+}
+
+void PhysicsEngine::solveIslands(int iterations) {
+    size_t island_count = batches.islandCount();
+    if (!scheduler || island_count < 2) {
+        for (size_t island = 0; island < island_count; island++) {
+            batches.solveIsland(island, particles, iterations);
+        }
+        return;
+    }
+
+    //острова независимы, так что результат совпадает с последовательным решением
+    scheduler->parallel_for(0, island_count, workGrain(island_count), [this, iterations](size_t b, size_t e) {
+        for (size_t island = b; island < e; island++) {
+            batches.solveIsland(island, particles, iterations);
+        }
+    });
+}
+
+void PhysicsEngine::solveJacobi(int iterations) {
+    if (!jacobi_ready) {
+        jacobi.build(particles, constraints);
+        jacobi_ready = true;
+    }
+    bool has_angles = batches.angleCount() > 0;
+    for (int iter = 0; iter < iterations; iter++) {
+        jacobi.iterate(particles, jacobi_omega, scheduler.get(), workGrain(particles.size()));
+        if (has_angles) batches.solveAngles(particles);
+    }
+}
+
+void PhysicsEngine::solveCG(int iterations, bool warm_start) {
+    if (!cg_ready) {
+        cg.build(particles, constraints);
+        cg_ready = true;
+    }
+    bool has_angles = batches.angleCount() > 0;
+    for (int iter = 0; iter < iterations; iter++) {
+        //множители прошлого шага - только для первой линеаризации, дальше остаются поправки
+        cg.iterate(particles, cg_max_iterations, cg_tolerance, warm_start && iter == 0, scheduler.get());
+        if (has_angles) batches.solveAngles(particles);
+    }
+}
+
+bool PhysicsEngine::seekStep(std::uint64_t target) {
+    //отложенные правки применились бы посреди досчёта и поменяли бы топологию
+    if (!pending_edits.empty()) return false;
+    syncParamsVersion();
+    const SnapshotRing::Slot* slot = snapshots.findAtOrBefore(target, topology_version, params_version);
+    if (!slot || slot->positions.size() != particles.size()) return false;
+
+    //массы и прочие параметры с момента снимка не менялись, иначе его бы не нашлось
+    for (size_t i = 0; i < particles.size(); i++) {
+        particles[i].position = slot->positions[i];
+        particles[i].velocity = slot->velocities[i];
+    }
+    current_time = slot->time;
+    step_count = slot->step;
+    //досчитываем с теми dt и итерациями, с которыми шла история, дальше - с текущими
+    double current_dt = time_step;
+    int current_iterations = solver_iterations;
+    time_step = slot->time_step;
+    solver_iterations = slot->solver_iterations;
+    //первый шаг после снимка должен начаться с тех же множителей CG
+    if (solver_mode == SolverMode::ConjugateGradient) {
+        prepareBatches();
+        if (!cg_ready) {
+            cg.build(particles, constraints);
+            cg_ready = true;
+        }
+        cg.setWarmStart(slot->warm);
+    }
+
+    //досчёт повторяет уже пройденные шаги: без правок, диагностики и следа хэшей
+    while (step_count < target) {
+        PENDULUM_TRACE_ZONE("PhysicsEngine::replayStep");
+        recordSnapshot();
+        solveStep();
+        current_time += time_step;
+        step_count++;
+    }
+    time_step = current_dt;
+    solver_iterations = current_iterations;
+    return true;
+}
+
+void PhysicsEngine::accumulateFieldForces() {
+    field_forces.resize(particles.size());
+    forEachParticle([this](size_t b, size_t e) {
+        std::fill(field_forces.begin() + b, field_forces.begin() + e, Vec2d{0, 0});
+    });
+
+    FieldContext ctx;
+    ctx.scheduler = scheduler.get();
+    ctx.grain = parallel_grain;
+    ctx.time = current_time;
+    for (const auto& field : force_fields) {
+        field->accumulate(particles, field_forces, ctx);
+    }
+}
+
+void PhysicsEngine::syncParamsVersion() {
+    std::uint64_t fields = 0;
+    for (const auto& field : force_fields) {
+        fields = std::max(fields, field->revision());
+    }
+    if (fields != seen_field_revision || colliders.version() != seen_colliders_version) {
+        seen_field_revision = fields;
+        seen_colliders_version = colliders.version();
+        params_version++;
+    }
+}
+
+void PhysicsEngine::beginStep() {
+    if (!pending_edits.empty()) {
+        PENDULUM_TRACE_ZONE("step.edits");
+        commitEdits();
+    }
+    if (auto_reorder != ReorderMethod::None && reorder_version != topology_version) {
+        PENDULUM_TRACE_ZONE("step.reorder");
+        reorderForLocality(auto_reorder);
+        reorder_version = topology_version;
+    }
+    recordSnapshot();
+}
+
+void PhysicsEngine::recordSnapshot() {
+    syncParamsVersion();
+    if (snapshots.wants(step_count, time_step, solver_iterations)) {
+        snapshots.record(particles, snapshotWarmStart(), current_time, step_count, time_step, solver_iterations,
+                         topology_version, params_version);
+    }
+}
+
+void PhysicsEngine::endStep() {
+    current_time += time_step;
+    step_count++;
+
+    //после шага 4: состояние шага уже окончательное
+    if (diagnostics.enabled() && step_count % diagnostics.interval() == 0) {
+        PENDULUM_TRACE_ZONE("step.diagnostics");
+        diagnostics.sample(particles, constraints, gravity, current_time, step_count, topology_version,
+                           scheduler.get());
+    }
+
+    if (hash_interval > 0 && step_count % hash_interval == 0) {
+        hash_trace.emplace_back(step_count, stateHash());
+    }
 }
 
 void PhysicsEngine::step() {
+    PENDULUM_TRACE_ZONE("PhysicsEngine::step");
+    beginStep();
+    solveStep();
+    endStep();
+}
+
+void PhysicsEngine::solveStep() {
+    //шаг 0: поля сил
+    bool has_fields = !force_fields.empty();
+    if (has_fields) {
+        PENDULUM_TRACE_ZONE("step.fields");
+        accumulateFieldForces();
+    }
+
     //шаг 1:Обновляем скорости внешними силами
-    for (auto& particle : particles) {
-        if (!particle.fixed) {
-            particle.velocity += gravity * time_step;
-            
-            //сопротивление
-            particle.velocity *= (1.0 - damping);
-        }
+    {
+        PENDULUM_TRACE_ZONE("step.integrate");
+        forEachParticle([this, has_fields](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++) {
+                Particle& particle = particles[i];
+                if (!particle.fixed) {
+                    particle.velocity += gravity * time_step;
+                    if (has_fields) {
+                        particle.velocity += field_forces[i] * (particle.inv_mass * time_step);
+                    }
+                    
+                    //сопротивление
+                    particle.velocity *= (1.0 - damping);
+                }
+            }
+        });
     }
     
     //шаг 2: Предсказываем позиции(без связей)
-    for (auto& particle : particles) {
-        particle.predicted_position = particle.position + particle.velocity * time_step;
-
+    {
+        PENDULUM_TRACE_ZONE("step.predict");
+        forEachParticle([this](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++) {
+                Particle& particle = particles[i];
+                particle.predicted_position = particle.position + particle.velocity * time_step;
+            }
+        });
     }
     
     //шаг 3: Решаем связи (корректируем предсказанные позиции)
-    for (int iter = 0; iter < solver_iterations; iter++) {
-        for (const auto& constraint : constraints) {
-            constraint.solve(particles);
-        }
+    {
+        PENDULUM_TRACE_ZONE("step.solve");
+        solveConstraints();
     }
     
-    
     //шаг 4: Обновляем позиции и вычисляем новые скорости
-    for (auto& particle : particles) {
-        if (!particle.fixed) {
-            //новая скорость
-            particle.velocity = (particle.predicted_position - particle.position) / time_step;
-            
-            //обновляем позицию
-            particle.position = particle.predicted_position;
-        }
+    {
+        PENDULUM_TRACE_ZONE("step.finalize");
+        forEachParticle([this](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++) {
+                Particle& particle = particles[i];
+                if (!particle.fixed) {
+                    //новая скорость
+                    particle.velocity = (particle.predicted_position - particle.position) / time_step;
+                    
+                    //обновляем позицию
+                    particle.position = particle.predicted_position;
+                }
+            }
+        });
     }
-    
-    current_time += time_step;
-}
+}
\ No newline at end of file
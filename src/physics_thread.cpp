@@ -0,0 +1,113 @@
+#include "../include/physics_thread.h"
+#include <chrono>
+#include "../include/trace.h"
+
+void PhysicsThread::start() {
+    if (running.exchange(true)) return;
+    publish();
+    worker = std::thread([this] { loop(); });
+}
+
+void PhysicsThread::stop() {
+    if (!running.exchange(false)) return;
+    command_cv.notify_all();
+    worker.join();
+}
+
+void PhysicsThread::post(Command cmd) {
+    {
+        std::lock_guard<std::mutex> lk(command_lock);
+        commands.push_back(std::move(cmd));
+    }
+    command_cv.notify_one();
+}
+
+void PhysicsThread::setPaused(bool p) {
+    paused.store(p);
+    command_cv.notify_one();
+}
+
+bool PhysicsThread::runCommands() {
+    PENDULUM_TRACE_ZONE("physics.commands");
+    std::vector<Command> pending;
+    {
+        std::lock_guard<std::mutex> lk(command_lock);
+        pending.swap(commands);
+    }
+    for (auto& cmd : pending) {
+        try {
+            cmd(engine);
+        } catch (const std::exception& e) {
+            std::cerr << "Physics command failed: " << e.what() << std::endl;
+        }
+    }
+    //правки из всех команд кадра - одной пачкой, даже на паузе
+    engine.commitEdits();
+    return !pending.empty();
+}
+
+void PhysicsThread::publish() {
+    PENDULUM_TRACE_ZONE("physics.publish");
+    EngineSnapshot& s = snapshots.writeBuffer();
+    size_t n = engine.getParticleCount();
+
+    s.positions.resize(n);
+    s.velocities.resize(n);
+    s.inv_mass.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        const Particle& p = engine.getParticle(i);
+        s.positions[i] = p.position;
+        s.velocities[i] = p.velocity;
+        s.inv_mass[i] = p.inv_mass;
+    }
+
+    if (s.topology_version != engine.getTopologyVersion()) {
+        s.fixed.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            s.fixed[i] = engine.getParticle(i).fixed;
+        }
+        s.links.resize(engine.getConstraintCount());
+        for (size_t i = 0; i < s.links.size(); i++) {
+            engine.getConstraint(i).getIndexes(s.links[i].first, s.links[i].second);
+        }
+        s.topology_version = engine.getTopologyVersion();
+    }
+
+    s.time = engine.getTime();
+    s.step = steps.load();
+    snapshots.publish();
+}
+
+void PhysicsThread::loop() {
+    Trace::setThreadName("physics");
+    using clock = std::chrono::steady_clock;
+    auto next_step = clock::now();
+
+    while (running.load()) {
+        bool changed = runCommands();
+
+        if (paused.load()) {
+            if (changed) publish();
+            std::unique_lock<std::mutex> lk(command_lock);
+            command_cv.wait_for(lk, std::chrono::milliseconds(50), [this] {
+                return !running.load() || !paused.load() || !commands.empty();
+            });
+            next_step = clock::now();
+            continue;
+        }
+
+        engine.step();
+        steps.fetch_add(1);
+        publish();
+
+        if (realtime.load()) {
+            auto dt = std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(engine.getTimeStep()));
+            next_step += dt;
+            auto now = clock::now();
+            //сильно отстали (например, был тяжёлый кадр) - не догоняем рывком
+            if (next_step < now - dt * 4) next_step = now;
+            std::this_thread::sleep_until(next_step);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#include "../include/quality_controller.h"
+#include "../include/physics_engine.h"
+#include "../include/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+    //сглаживание цены кадра
+    const double AVG_WEIGHT = 0.2;
+    //спуск: бюджет превышен столько кадров подряд
+    const int DOWN_FRAMES = 3;
+    //подъём: следующая ступень по оценке занимает не больше этой доли бюджета
+    const double UP_MARGIN = 0.75;
+    //после смены ступени оценка ещё не устоялась
+    const int COOLDOWN_FRAMES = 10;
+    //спуск вскоре после подъёма - подъём был неудачным
+    const int FAILED_UP_WINDOW = 120;
+    const int MIN_UP_FRAMES = 30;
+    const int MAX_UP_FRAMES = 960;
+}
+
+QualityController::QualityController(PhysicsEngine& eng, double dt) : engine(eng), frame_dt(dt) {
+    setLevels({{1, 2}, {1, 4}, {1, 6}, {1, 10}, {2, 8}, {2, 12}, {3, 12}, {4, 15}});
+}
+
+void QualityController::setFrameTime(double dt) {
+    if (dt <= 0.0) return;
+    frame_dt = dt;
+    apply();
+}
+
+void QualityController::setLevels(std::vector<QualityLevel> ladder) {
+    ladder.erase(std::remove_if(ladder.begin(), ladder.end(),
+                                [](const QualityLevel& q) { return q.substeps < 1 || q.iterations < 1; }),
+                 ladder.end());
+    if (ladder.empty()) return;
+
+    //продолжаем с той работой, что движок делает сейчас
+    double now = levels.empty()
+        ? work({std::max(1, int(std::lround(frame_dt / engine.getTimeStep()))), engine.getSolverIterations()})
+        : work(levels[current]);
+    levels = std::move(ladder);
+    current = 0;
+    for (size_t i = 1; i < levels.size(); i++) {
+        if (std::abs(work(levels[i]) - now) < std::abs(work(levels[current]) - now)) current = i;
+    }
+    min_level = std::min(min_level, levels.size() - 1);
+    current = std::max(current, min_level);
+    apply();
+}
+
+void QualityController::setMinLevel(size_t level) {
+    min_level = std::min(level, levels.size() - 1);
+    if (current < min_level) setLevel(min_level);
+}
+
+void QualityController::setLevel(size_t level) {
+    level = std::clamp(level, min_level, levels.size() - 1);
+    if (level == current) return;
+    //оценку цены переносим на новую ступень, чтобы не ждать, пока среднее догонит
+    if (have_avg) avg_ms *= work(levels[level]) / work(levels[current]);
+    current = level;
+    over_frames = 0;
+    under_frames = 0;
+    cooldown = COOLDOWN_FRAMES;
+    apply();
+    if (listener) listener(current);
+}
+
+void QualityController::apply() {
+    const QualityLevel& q = levels[current];
+    engine.setTimeStep(frame_dt / q.substeps);
+    engine.setSolverIterations(q.iterations);
+}
+
+void QualityController::advance() {
+    auto start = std::chrono::steady_clock::now();
+    {
+        PENDULUM_TRACE_ZONE("quality.advance");
+        for (int i = 0; i < levels[current].substeps; i++) {
+            engine.step();
+        }
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (adaptive) adapt(ms);
+}
+
+void QualityController::adapt(double cost_ms) {
+    avg_ms = have_avg ? avg_ms + AVG_WEIGHT * (cost_ms - avg_ms) : cost_ms;
+    have_avg = true;
+    if (frames_since_up >= 0) frames_since_up++;
+    if (cooldown > 0) {
+        cooldown--;
+        return;
+    }
+
+    //спуск быстрый: пропущенные кадры заметнее, чем чуть меньшая точность
+    over_frames = avg_ms > budget_ms ? over_frames + 1 : 0;
+    if (over_frames >= DOWN_FRAMES && current > min_level) {
+        if (frames_since_up >= 0 && frames_since_up < FAILED_UP_WINDOW) {
+            up_frames = std::min(up_frames * 2, MAX_UP_FRAMES);
+        }
+        frames_since_up = -1;
+        setLevel(current - 1);
+        return;
+    }
+
+    //подъём медленный и только если следующая ступень по оценке влезает с запасом
+    if (current + 1 >= levels.size()) return;
+    double predicted = avg_ms * work(levels[current + 1]) / work(levels[current]);
+    under_frames = predicted <= budget_ms * UP_MARGIN ? under_frames + 1 : 0;
+    if (under_frames >= up_frames) {
+        //долго держались без провалов - снова доверяем быстрым подъёмам
+        if (frames_since_up < 0 || frames_since_up >= FAILED_UP_WINDOW) {
+            up_frames = std::max(MIN_UP_FRAMES, up_frames / 2);
+        }
+        frames_since_up = 0;
+        setLevel(current + 1);
+    }
+}
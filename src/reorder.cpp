@@ -0,0 +1,173 @@
+#include "../include/physics_engine.h"
+#include <algorithm>
+
+namespace {
+    const size_t NONE = size_t(-1);
+
+    //граф связей в виде CSR: соседи частицы i - adj[start[i] .. start[i + 1])
+    struct Graph {
+        std::vector<size_t> start;
+        std::vector<size_t> adj;
+
+        size_t degree(size_t i) const { return start[i + 1] - start[i]; }
+    };
+
+    Graph build_graph(size_t n, const std::vector<Constraint>& constraints,
+                      const std::vector<AngleConstraint>& angles) {
+        std::vector<std::pair<size_t, size_t>> edges;
+        edges.reserve(constraints.size() + angles.size() * 2);
+        for (const auto& c : constraints) {
+            edges.emplace_back(c.particle1_idx, c.particle2_idx);
+        }
+        for (const auto& a : angles) {
+            edges.emplace_back(a.a, a.center);
+            edges.emplace_back(a.center, a.b);
+        }
+
+        Graph g;
+        g.start.assign(n + 1, 0);
+        for (const auto& [a, b] : edges) {
+            g.start[a + 1]++;
+            g.start[b + 1]++;
+        }
+        for (size_t i = 0; i < n; i++) {
+            g.start[i + 1] += g.start[i];
+        }
+        g.adj.resize(g.start[n]);
+        std::vector<size_t> cursor(g.start.begin(), g.start.end() - 1);
+        for (const auto& [a, b] : edges) {
+            g.adj[cursor[a]++] = b;
+            g.adj[cursor[b]++] = a;
+        }
+        return g;
+    }
+
+    struct Levels {
+        size_t last_begin;  //где в order начинается последний уровень
+        size_t depth;       //число уровней
+    };
+
+    //обход в ширину от start, порядок дописывается в order; by_degree - соседи по
+    //возрастанию степени (Катхилл-Макки)
+    Levels bfs(const Graph& g, size_t start, std::vector<size_t>& mark, size_t stamp,
+               std::vector<size_t>& order, bool by_degree) {
+        size_t head = order.size();
+        order.push_back(start);
+        mark[start] = stamp;
+        Levels levels{head, 0};
+
+        std::vector<size_t> next;
+        while (head < order.size()) {
+            //все вершины текущего уровня уже в order - обходим их, собирая следующий
+            size_t level_end = order.size();
+            levels.last_begin = head;
+            levels.depth++;
+            for (; head < level_end; head++) {
+                size_t v = order[head];
+                next.clear();
+                for (size_t k = g.start[v]; k < g.start[v + 1]; k++) {
+                    size_t u = g.adj[k];
+                    if (mark[u] == stamp) continue;
+                    mark[u] = stamp;
+                    next.push_back(u);
+                }
+                if (by_degree) {
+                    std::stable_sort(next.begin(), next.end(),
+                                     [&g](size_t a, size_t b) { return g.degree(a) < g.degree(b); });
+                }
+                order.insert(order.end(), next.begin(), next.end());
+            }
+        }
+        return levels;
+    }
+
+    //псевдопериферийная вершина (Джордж-Лю): переходим в вершину наименьшей степени
+    //из последнего уровня, пока глубина обхода растёт; RCM от неё даёт узкую ленту
+    size_t pseudo_peripheral(const Graph& g, size_t seed, std::vector<size_t>& mark, size_t& stamp) {
+        std::vector<size_t> order;
+        Levels levels = bfs(g, seed, mark, ++stamp, order, false);
+        size_t best = seed;
+        for (int round = 0; round < 8; round++) {
+            size_t candidate = order[levels.last_begin];
+            for (size_t k = levels.last_begin; k < order.size(); k++) {
+                if (g.degree(order[k]) < g.degree(candidate)) candidate = order[k];
+            }
+            order.clear();
+            Levels next = bfs(g, candidate, mark, ++stamp, order, false);
+            if (next.depth <= levels.depth) break;
+            best = candidate;
+            levels = next;
+        }
+        return best;
+    }
+
+    std::vector<size_t> locality_order(const Graph& g, size_t n, ReorderMethod method) {
+        bool rcm = method == ReorderMethod::ReverseCuthillMcKee;
+        std::vector<size_t> order;
+        order.reserve(n);
+        std::vector<size_t> mark(n, NONE);
+        std::vector<size_t> placed(n, NONE);
+        size_t stamp = 0;
+
+        //компоненты по возрастанию исходного индекса: несвязанные части не перемешиваются
+        for (size_t seed = 0; seed < n; seed++) {
+            if (placed[seed] != NONE) continue;
+            if (g.degree(seed) == 0) {
+                placed[seed] = 0;
+                order.push_back(seed);
+                continue;
+            }
+            size_t start = rcm ? pseudo_peripheral(g, seed, mark, stamp) : seed;
+            size_t begin = order.size();
+            bfs(g, start, placed, 0, order, rcm);
+            if (rcm) std::reverse(order.begin() + begin, order.end());
+        }
+        return order;
+    }
+}
+
+bool PhysicsEngine::reorderForLocality(ReorderMethod method) {
+    if (method == ReorderMethod::None || particles.empty()) return false;
+
+    size_t n = particles.size();
+    ReorderMap map;
+    map.old_of_new = locality_order(build_graph(n, constraints, angle_constraints), n, method);
+    map.new_of_old.resize(n);
+    bool identity = true;
+    for (size_t k = 0; k < n; k++) {
+        map.new_of_old[map.old_of_new[k]] = k;
+        identity = identity && map.old_of_new[k] == k;
+    }
+    if (identity) return false;
+
+    std::vector<Particle> moved;
+    moved.reserve(n);
+    for (size_t k = 0; k < n; k++) {
+        moved.push_back(particles[map.old_of_new[k]]);
+    }
+    particles.swap(moved);
+
+    //порядок связей не трогаем: Гаусс-Зейдель проходит их по очереди, и другой
+    //порядок дал бы другой (при длинных цепочках - заметно худший) результат
+    for (auto& c : constraints) {
+        c.particle1_idx = map.new_of_old[c.particle1_idx];
+        c.particle2_idx = map.new_of_old[c.particle2_idx];
+    }
+    for (auto& a : angle_constraints) {
+        a.a = map.new_of_old[a.a];
+        a.center = map.new_of_old[a.center];
+        a.b = map.new_of_old[a.b];
+    }
+
+    for (const auto& field : force_fields) {
+        field->remapParticles(map.new_of_old, particles.size());
+    }
+
+    size_t old_version = topology_version;
+    topology_version++;
+    snapshots.permute(map.old_of_new, old_version, topology_version);
+    reorder_version = topology_version;
+
+    if (reorder_listener) reorder_listener(map);
+    return true;
+}
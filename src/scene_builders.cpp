@@ -0,0 +1,183 @@
+#include "../include/physics_engine.h"
+#include <cmath>
+
+SceneRange PhysicsEngine::beginBulk(size_t particle_count, size_t constraint_count) {
+    reserve(particle_count, constraint_count);
+
+    SceneRange range;
+    range.first_particle = particles.size();
+    range.first_constraint = constraints.size();
+    return range;
+}
+
+void PhysicsEngine::endBulk(SceneRange& range) {
+    range.particle_count = particles.size() - range.first_particle;
+    range.constraint_count = constraints.size() - range.first_constraint;
+    topology_version++;
+}
+
+size_t PhysicsEngine::appendParticle(const Vec2d& position, double mass, bool fixed) {
+    particles.emplace_back(position, mass, Vec2d{0, 0}, fixed);
+    return particles.size() - 1;
+}
+
+void PhysicsEngine::appendConstraint(size_t idx1, size_t idx2, double stiffness) {
+    double length = leight(particles[idx2].position - particles[idx1].position);
+    constraints.emplace_back(idx1, idx2, length, stiffness);
+}
+
+SceneRange PhysicsEngine::addParticles(const Vec2d* positions, size_t count, const double* masses,
+                                       const std::uint8_t* fixed) {
+    SceneRange range = beginBulk(count, 0);
+    for (size_t i = 0; i < count; i++) {
+        appendParticle(positions[i], masses ? masses[i] : 1.0, fixed && fixed[i]);
+    }
+    endBulk(range);
+    return range;
+}
+
+SceneRange PhysicsEngine::addConstraints(const size_t* pairs, size_t count, const double* lengths,
+                                         const double* stiffness) {
+    for (size_t k = 0; k < count; k++) {
+        size_t a = pairs[2 * k];
+        size_t b = pairs[2 * k + 1];
+        if (a >= particles.size() || b >= particles.size()) {
+            throw std::out_of_range("Invalid particle index");
+        }
+        if (a == b) {
+            throw std::invalid_argument("Cannot create constraint with itself");
+        }
+        double length = lengths ? lengths[k] : leight(particles[b].position - particles[a].position);
+        if (length <= 0.0) {
+            throw std::invalid_argument("Constraint length must be positive");
+        }
+        if (stiffness && (stiffness[k] < 0.0 || stiffness[k] > 1.0)) {
+            throw std::invalid_argument("Stiffness must be between 0 and 1");
+        }
+    }
+
+    SceneRange range = beginBulk(0, count);
+    for (size_t k = 0; k < count; k++) {
+        size_t a = pairs[2 * k];
+        size_t b = pairs[2 * k + 1];
+        double length = lengths ? lengths[k] : leight(particles[b].position - particles[a].position);
+        constraints.emplace_back(a, b, length, stiffness ? stiffness[k] : 1.0);
+    }
+    endBulk(range);
+    return range;
+}
+
+size_t PhysicsEngine::createSimplePendulum(const Vec2d& pivot, double length, double mass) {
+    SceneRange range = createChain(pivot, 1, length, mass);
+    return range.first_particle + 1;
+}
+
+void PhysicsEngine::createDoublePendulum(const Vec2d& pivot, double l1, double l2, double m1, double m2) {
+    SceneRange range = beginBulk(3, 2);
+    size_t p0 = appendParticle(pivot, 1.0, true);
+    size_t p1 = appendParticle(pivot + Vec2d{l1, 0}, m1);
+    size_t p2 = appendParticle(pivot + Vec2d{l1 + l2, 0}, m2);
+    appendConstraint(p0, p1);
+    appendConstraint(p1, p2);
+    endBulk(range);
+}
+
+SceneRange PhysicsEngine::createChain(const Vec2d& pivot, size_t links, double link_length, double mass,
+                                      const Vec2d& direction, double stiffness) {
+    if (link_length <= 0.0) {
+        throw std::invalid_argument("Constraint length must be positive");
+    }
+    Vec2d dir = direction / leight(direction);
+
+    SceneRange range = beginBulk(links + 1, links);
+    size_t prev = appendParticle(pivot, 1.0, true);
+    for (size_t i = 1; i <= links; i++) {
+        size_t cur = appendParticle(pivot + dir * (link_length * i), mass);
+        appendConstraint(prev, cur, stiffness);
+        prev = cur;
+    }
+    endBulk(range);
+    return range;
+}
+
+SceneRange PhysicsEngine::createRope(const Vec2d& from, const Vec2d& to, size_t segments, double total_mass,
+                                     double stiffness) {
+    if (segments == 0) {
+        throw std::invalid_argument("Rope needs at least one segment");
+    }
+    double length = leight(to - from);
+    return createChain(from, segments, length / segments, total_mass / segments, to - from, stiffness);
+}
+
+SceneRange PhysicsEngine::createBinaryTree(const Vec2d& root, size_t depth, double length, double mass,
+                                           double spread) {
+    if (length <= 0.0) {
+        throw std::invalid_argument("Constraint length must be positive");
+    }
+    size_t nodes = (size_t(1) << (depth + 1)) - 1;
+
+    //при обходе в ширину дети узла k лежат в 2k+1 и 2k+2, связи идут в том же порядке
+    SceneRange range = beginBulk(nodes, nodes - 1);
+    size_t base = appendParticle(root, 1.0, true);
+    for (size_t k = 1; k < nodes; k++) {
+        size_t parent = (k - 1) / 2;
+        size_t level = static_cast<size_t>(std::log2(static_cast<double>(k + 1)));
+        double side = (k % 2 == 1) ? -1.0 : 1.0;
+        Vec2d offset{side * spread / double(size_t(1) << level), length};
+
+        size_t idx = appendParticle(particles[base + parent].position + offset, mass);
+        appendConstraint(base + parent, idx);
+    }
+    endBulk(range);
+    return range;
+}
+
+SceneRange PhysicsEngine::createClothGrid(const Vec2d& origin, size_t cols, size_t rows, double spacing,
+                                          double mass, double stiffness, bool pin_top) {
+    if (spacing <= 0.0) {
+        throw std::invalid_argument("Constraint length must be positive");
+    }
+    if (cols == 0 || rows == 0) return SceneRange{particles.size(), 0, constraints.size(), 0};
+
+    size_t links = (cols - 1) * rows + cols * (rows - 1);
+    SceneRange range = beginBulk(cols * rows, links);
+    size_t base = particles.size();
+
+    for (size_t r = 0; r < rows; r++) {
+        for (size_t c = 0; c < cols; c++) {
+            appendParticle(origin + Vec2d{c * spacing, r * spacing}, mass, pin_top && r == 0);
+        }
+    }
+    //связи каждой частицы (вправо и вниз) идут подряд, как и сами частицы
+    for (size_t r = 0; r < rows; r++) {
+        for (size_t c = 0; c < cols; c++) {
+            size_t idx = base + r * cols + c;
+            if (c + 1 < cols) appendConstraint(idx, idx + 1, stiffness);
+            if (r + 1 < rows) appendConstraint(idx, idx + cols, stiffness);
+        }
+    }
+    endBulk(range);
+    return range;
+}
+
+SceneRange PhysicsEngine::createPendulumArray(const Vec2d& first_pivot, const Vec2d& pivot_spacing, size_t count,
+                                              size_t links_per_pendulum, double link_length, double mass,
+                                              double angle) {
+    if (link_length <= 0.0) {
+        throw std::invalid_argument("Constraint length must be positive");
+    }
+    Vec2d dir = rotate(-angle, Vec2d{0, 1});
+
+    SceneRange range = beginBulk(count * (links_per_pendulum + 1), count * links_per_pendulum);
+    for (size_t k = 0; k < count; k++) {
+        Vec2d pivot = first_pivot + pivot_spacing * double(k);
+        size_t prev = appendParticle(pivot, 1.0, true);
+        for (size_t i = 1; i <= links_per_pendulum; i++) {
+            size_t cur = appendParticle(pivot + dir * (link_length * i), mass);
+            appendConstraint(prev, cur);
+            prev = cur;
+        }
+    }
+    endBulk(range);
+    return range;
+}
@@ -0,0 +1,142 @@
+#include "../include/snapshot_ring.h"
+#include "../include/physics_engine.h"
+#include <algorithm>
+#include <utility>
+
+void SnapshotRing::configure(size_t memory_budget, size_t interval) {
+    budget = memory_budget;
+    every = interval > 0 ? interval : 1;
+    slots.clear();
+    slots.shrink_to_fit();
+    head = 0;
+    count = 0;
+    slot_bytes = 0;
+    version = size_t(-1);
+    params = size_t(-1);
+}
+
+void SnapshotRing::resize(size_t capacity) {
+    size_t keep = std::min(count, capacity);
+    std::vector<Slot> moved(capacity);
+    for (size_t k = 0; k < keep; k++) {
+        moved[k] = std::move(at(count - keep + k));
+    }
+    slots.swap(moved);
+    head = 0;
+    count = keep;
+}
+
+size_t SnapshotRing::latestAtOrBefore(std::uint64_t step) const {
+    //снимки лежат по возрастанию шага, ищем двоичным поиском
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (at(mid).step <= step) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo == 0 ? count : lo - 1;
+}
+
+bool SnapshotRing::wants(std::uint64_t step, double time_step, int solver_iterations) const {
+    if (budget == 0) return false;
+    if (step % every == 0) return true;
+    size_t k = latestAtOrBefore(step);
+    if (k == count) return false;
+    const Slot& prev = at(k);
+    return prev.time_step != time_step || prev.solver_iterations != solver_iterations;
+}
+
+void SnapshotRing::record(const std::vector<Particle>& particles, const std::vector<double>& warm, double time,
+                          std::uint64_t step, double time_step, int solver_iterations,
+                          size_t topology_version, size_t params_version) {
+    if (budget == 0) return;
+    if (topology_version != version || params_version != params) {
+        count = 0;
+        version = topology_version;
+        params = params_version;
+    }
+    size_t k = latestAtOrBefore(step);
+    if (k != count && (at(k).time_step != time_step || at(k).solver_iterations != solver_iterations)) {
+        //дальше история считалась с другими параметрами: с этого шага она другая
+        while (count > 0 && newestStep() >= step) {
+            count--;
+        }
+    } else if (count > 0 && step <= newestStep()) {
+        //после перемотки назад заново пройденные шаги уже лежат в буфере
+        return;
+    }
+
+    //ёмкость - по размеру снимка; он растёт со сменой топологии и с появлением
+    //множителей CG, тогда старые снимки вытесняются, чтобы уложиться в бюджет
+    size_t bytes = sizeof(Slot) + particles.size() * 2 * sizeof(Vec2d) + warm.size() * sizeof(double);
+    if (count == 0 || bytes > slot_bytes) {
+        slot_bytes = bytes;
+        size_t capacity = std::max<size_t>(1, budget / bytes);
+        if (capacity != slots.size()) resize(capacity);
+    }
+
+    size_t idx;
+    if (count < slots.size()) {
+        idx = (head + count) % slots.size();
+        count++;
+    } else {
+        idx = head;
+        head = (head + 1) % slots.size();
+    }
+
+    //размер меняется только вместе с топологией, в обычном шаге память не выделяется
+    Slot& slot = slots[idx];
+    size_t n = particles.size();
+    slot.positions.resize(n);
+    slot.velocities.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        slot.positions[i] = particles[i].position;
+        slot.velocities[i] = particles[i].velocity;
+    }
+    slot.warm.assign(warm.begin(), warm.end());
+    slot.time = time;
+    slot.step = step;
+    slot.time_step = time_step;
+    slot.solver_iterations = solver_iterations;
+}
+
+const SnapshotRing::Slot* SnapshotRing::findAtOrBefore(std::uint64_t step, size_t topology_version,
+                                                       size_t params_version) const {
+    if (topology_version != version || params_version != params) return nullptr;
+    size_t k = latestAtOrBefore(step);
+    return k == count ? nullptr : &at(k);
+}
+
+void SnapshotRing::permute(const std::vector<size_t>& old_of_new, size_t from_version, size_t to_version) {
+    if (version != from_version) return;
+    size_t n = old_of_new.size();
+    std::vector<Vec2d> scratch(n);
+    for (size_t k = 0; k < count; k++) {
+        Slot& slot = at(k);
+        if (slot.positions.size() != n) {
+            count = 0;
+            break;
+        }
+        for (auto* v : {&slot.positions, &slot.velocities}) {
+            for (size_t i = 0; i < n; i++) {
+                scratch[i] = (*v)[old_of_new[i]];
+            }
+            v->swap(scratch);
+        }
+    }
+    version = to_version;
+}
+
+void SnapshotRing::truncateAfter(std::uint64_t step) {
+    while (count > 0 && newestStep() > step) {
+        count--;
+    }
+}
+
+std::uint64_t SnapshotRing::oldestStep() const {
+    return count ? at(0).step : 0;
+}
+
+std::uint64_t SnapshotRing::newestStep() const {
+    return count ? at(count - 1).step : 0;
+}
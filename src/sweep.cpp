@@ -0,0 +1,454 @@
+#include "../include/sweep.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const double PI = 3.14159265358979323846;
+    const double GRAVITY = 300.0;
+    const double LENGTH1 = 100.0;
+    const double MASS1 = 1.0;
+
+    const char* const PARAM_NAMES[SWEEP_PARAM_COUNT] = {"theta1", "theta2", "mass2", "length2", "damping"};
+
+    double wrap_angle(double a) {
+        return std::atan2(std::sin(a), std::cos(a));
+    }
+
+    //угол звена от вертикали вниз (ось y направлена вниз)
+    double link_angle(const Vec2d& from, const Vec2d& to) {
+        Vec2d d = to - from;
+        return std::atan2(d.x, d.y);
+    }
+
+    double energy(const PhysicsEngine& engine) {
+        double e = 0.0;
+        for (size_t i = 0; i < engine.getParticleCount(); i++) {
+            const Particle& p = engine.getParticle(i);
+            if (p.fixed) continue;
+            double m = 1.0 / p.inv_mass;
+            e += 0.5 * m * dot(p.velocity, p.velocity) - m * GRAVITY * p.position.y;
+        }
+        return e;
+    }
+
+    //ось из аргумента: одно число или lo hi n
+    bool parse_axis(const CliArgs& args, const std::string& key, SweepAxis& axis) {
+        std::vector<std::string> raw = args.values(key);
+        if (raw.empty()) return true;
+        try {
+            if (raw.size() == 1) {
+                axis.lo = axis.hi = std::stod(raw[0]);
+                axis.count = 1;
+                return true;
+            }
+            if (raw.size() == 3) {
+                axis.lo = std::stod(raw[0]);
+                axis.hi = std::stod(raw[1]);
+                long long n = std::stoll(raw[2]);
+                if (n >= 1 && n <= 1000000) {
+                    axis.count = static_cast<std::uint32_t>(n);
+                    return true;
+                }
+            }
+        } catch (...) {
+        }
+        std::cerr << key << " takes one value or <lo> <hi> <count>" << std::endl;
+        return false;
+    }
+}
+
+double SweepAxis::value(std::uint64_t i) const {
+    if (count <= 1) return lo;
+    return lo + (hi - lo) * double(i) / double(count - 1);
+}
+
+std::uint64_t SweepSpec::pointCount() const {
+    std::uint64_t n = 1;
+    for (const SweepAxis& a : axes) {
+        n *= a.count;
+    }
+    return n;
+}
+
+std::uint64_t SweepSpec::shardCount() const {
+    return (pointCount() + shard_size - 1) / shard_size;
+}
+
+void SweepSpec::point(std::uint64_t index, double params[SWEEP_PARAM_COUNT]) const {
+    for (int k = 0; k < SWEEP_PARAM_COUNT; k++) {
+        params[k] = axes[k].value(index % axes[k].count);
+        index /= axes[k].count;
+    }
+}
+
+bool operator==(const SweepSpec& a, const SweepSpec& b) {
+    for (int k = 0; k < SWEEP_PARAM_COUNT; k++) {
+        if (a.axes[k].lo != b.axes[k].lo || a.axes[k].hi != b.axes[k].hi || a.axes[k].count != b.axes[k].count) {
+            return false;
+        }
+    }
+    return a.sim_time == b.sim_time && a.dt == b.dt && a.iterations == b.iterations && a.shard_size == b.shard_size;
+}
+
+SweepRecord run_sweep_point(const SweepSpec& spec, std::uint64_t index) {
+    SweepRecord rec{};
+    spec.point(index, rec.params);
+    double theta1 = rec.params[SWEEP_THETA1];
+    double theta2 = rec.params[SWEEP_THETA2];
+    double mass2 = rec.params[SWEEP_MASS2];
+    double length2 = rec.params[SWEEP_LENGTH2];
+
+    //процессов столько, сколько ядер, - внутри каждого один поток
+    PhysicsEngine engine(Vec2d(0, GRAVITY), spec.dt, spec.iterations, rec.params[SWEEP_DAMPING]);
+    engine.setThreadCount(1);
+    Vec2d pivot{0.0, 0.0};
+    engine.createDoublePendulum(pivot, LENGTH1, length2, MASS1, mass2);
+    Particle& p1 = engine.getParticle(1);
+    Particle& p2 = engine.getParticle(2);
+    p1.position = pivot + Vec2d{LENGTH1 * std::sin(theta1), LENGTH1 * std::cos(theta1)};
+    p2.position = p1.position + Vec2d{length2 * std::sin(theta2), length2 * std::cos(theta2)};
+    p1.predicted_position = p1.position;
+    p2.predicted_position = p2.position;
+
+    double e0 = energy(engine);
+    //переворот - угол второго звена, прослеженный без скачков через pi, ушёл за pi
+    double prev = link_angle(p1.position, p2.position);
+    double unwrapped = prev;
+    rec.flip_time = std::numeric_limits<double>::quiet_NaN();
+    long long steps = static_cast<long long>(std::ceil(spec.sim_time / spec.dt));
+    for (long long i = 0; i < steps; i++) {
+        engine.step();
+        double a = link_angle(engine.getParticle(1).position, engine.getParticle(2).position);
+        unwrapped += wrap_angle(a - prev);
+        prev = a;
+        if (std::isnan(rec.flip_time) && std::abs(unwrapped) > PI) {
+            rec.flip_time = engine.getTime();
+        }
+    }
+
+    rec.theta1 = wrap_angle(link_angle(pivot, engine.getParticle(1).position));
+    rec.theta2 = wrap_angle(prev);
+    rec.energy_drift = (energy(engine) - e0) / ((MASS1 + mass2) * GRAVITY * (LENGTH1 + length2));
+    return rec;
+}
+
+#if !defined(_WIN32)
+
+namespace {
+    const char SWEEP_MAGIC[8] = {'P', 'N', 'D', 'S', 'W', 'E', 'E', 'P'};
+    const std::uint32_t SWEEP_VERSION = 1;
+    //записи начинаются с границы страницы: шард сбрасывается на диск своим msync
+    const std::uint64_t RECORDS_ALIGN = 4096;
+
+    const unsigned char SHARD_PENDING = 0;
+    const unsigned char SHARD_DONE = 1;
+
+    //заголовок файла, за ним байт состояния на шард, затем записи с RECORDS_ALIGN
+    struct SweepFileHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t record_size;
+        SweepSpec spec;
+        std::uint64_t point_count;
+        std::uint64_t shard_count;
+        std::uint64_t records_offset;
+    };
+
+    std::uint64_t records_offset(std::uint64_t shard_count) {
+        std::uint64_t end = sizeof(SweepFileHeader) + shard_count;
+        return (end + RECORDS_ALIGN - 1) / RECORDS_ALIGN * RECORDS_ALIGN;
+    }
+
+    //файл результатов, отображённый в память целиком
+    class SweepFile {
+    public:
+        ~SweepFile() {
+            if (base) munmap(base, size);
+            if (fd >= 0) close(fd);
+        }
+
+        //создать новый файл под spec или открыть существующий того же перебора
+        bool open(const std::string& path, const SweepSpec* spec) {
+            bool exists = access(path.c_str(), F_OK) == 0;
+            if (!exists && !spec) {
+                std::cerr << "No sweep file " << path << std::endl;
+                return false;
+            }
+            fd = ::open(path.c_str(), exists ? O_RDWR : O_RDWR | O_CREAT | O_EXCL, 0644);
+            if (fd < 0) {
+                std::cerr << "Cannot open " << path << ": " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            if (!exists) {
+                SweepFileHeader h{};
+                std::memcpy(h.magic, SWEEP_MAGIC, sizeof(h.magic));
+                h.version = SWEEP_VERSION;
+                h.record_size = sizeof(SweepRecord);
+                h.spec = *spec;
+                h.point_count = spec->pointCount();
+                h.shard_count = spec->shardCount();
+                h.records_offset = records_offset(h.shard_count);
+                //файл из нулей - все шарды ещё не посчитаны
+                static_assert(SHARD_PENDING == 0, "fresh file must read as pending");
+                size = h.records_offset + h.point_count * sizeof(SweepRecord);
+                if (ftruncate(fd, static_cast<off_t>(size)) != 0 || !map(path)) return false;
+                std::memcpy(base, &h, sizeof(h));
+                msync(base, sizeof(h), MS_SYNC);
+                return true;
+            }
+
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SweepFileHeader))) {
+                std::cerr << path << " is not a sweep file" << std::endl;
+                return false;
+            }
+            size = static_cast<size_t>(st.st_size);
+            if (!map(path)) return false;
+            const SweepFileHeader& h = header();
+            if (std::memcmp(h.magic, SWEEP_MAGIC, sizeof(h.magic)) != 0 || h.version != SWEEP_VERSION ||
+                h.record_size != sizeof(SweepRecord) || h.shard_count != h.spec.shardCount() ||
+                h.records_offset != records_offset(h.shard_count) ||
+                size < h.records_offset + h.point_count * sizeof(SweepRecord)) {
+                std::cerr << path << " is not a sweep file of this version" << std::endl;
+                return false;
+            }
+            if (spec && !(*spec == h.spec)) {
+                std::cerr << path << " holds a different sweep; repeat its options or use a new file" << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        const SweepFileHeader& header() const { return *reinterpret_cast<const SweepFileHeader*>(base); }
+        unsigned char* states() { return base + sizeof(SweepFileHeader); }
+        SweepRecord* records() { return reinterpret_cast<SweepRecord*>(base + header().records_offset); }
+
+        //сначала записи шарда, потом его отметка: отметка без записей на диске не окажется
+        void commitShard(std::uint64_t shard, std::uint64_t first, std::uint64_t count) {
+            sync(reinterpret_cast<unsigned char*>(records() + first), count * sizeof(SweepRecord));
+            states()[shard] = SHARD_DONE;
+            sync(states() + shard, 1);
+        }
+
+    private:
+        bool map(const std::string& path) {
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                std::cerr << "Cannot map " << path << ": " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            base = static_cast<unsigned char*>(p);
+            return true;
+        }
+
+        //msync принимает только адрес с границы страницы
+        void sync(unsigned char* from, size_t bytes) {
+            size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            size_t offset = static_cast<size_t>(from - base) / page * page;
+            msync(base + offset, static_cast<size_t>(from - base) + bytes - offset, MS_SYNC);
+        }
+
+        int fd = -1;
+        unsigned char* base = nullptr;
+        size_t size = 0;
+    };
+
+    pid_t launch_worker(const std::string& exe, const std::string& path, std::uint64_t shard) {
+        std::string shard_arg = std::to_string(shard);
+        pid_t pid = fork();
+        if (pid == 0) {
+            char* argv[] = {const_cast<char*>(exe.c_str()), const_cast<char*>("--sweep-worker"),
+                            const_cast<char*>(path.c_str()), const_cast<char*>("--shard"),
+                            const_cast<char*>(shard_arg.c_str()), nullptr};
+            execv(exe.c_str(), argv);
+            _exit(127);
+        }
+        return pid;
+    }
+
+    bool write_csv(const std::string& path, SweepFile& file) {
+        std::ofstream out(path);
+        if (!out) return false;
+        for (const char* name : PARAM_NAMES) {
+            out << name << ",";
+        }
+        out << "flip_time,theta1_end,theta2_end,energy_drift\n";
+        const SweepFileHeader& h = file.header();
+        const SweepRecord* rec = file.records();
+        char buf[128];
+        for (std::uint64_t s = 0; s < h.shard_count; s++) {
+            if (file.states()[s] != SHARD_DONE) continue;
+            std::uint64_t end = std::min(h.point_count, (s + 1) * h.spec.shard_size);
+            for (std::uint64_t i = s * h.spec.shard_size; i < end; i++) {
+                for (double v : rec[i].params) {
+                    std::snprintf(buf, sizeof(buf), "%.9g,", v);
+                    out << buf;
+                }
+                std::snprintf(buf, sizeof(buf), "%.9g,%.9g,%.9g,%.9g\n", rec[i].flip_time, rec[i].theta1,
+                              rec[i].theta2, rec[i].energy_drift);
+                out << buf;
+            }
+        }
+        return true;
+    }
+}
+
+int sweep_mode(const CliArgs& args, const char* self_path) {
+    std::string path = args.get("--sweep");
+    if (path.empty()) {
+        std::cerr << "--sweep needs a result file" << std::endl;
+        return 2;
+    }
+    SweepSpec spec;
+    //по умолчанию - карта переворотов по двум начальным углам
+    spec.axes[SWEEP_THETA1] = {-PI, PI, 32, 0};
+    spec.axes[SWEEP_THETA2] = {-PI, PI, 32, 0};
+    spec.axes[SWEEP_MASS2] = {1.0, 1.0, 1, 0};
+    spec.axes[SWEEP_LENGTH2] = {100.0, 100.0, 1, 0};
+    spec.axes[SWEEP_DAMPING] = {0.0, 0.0, 1, 0};
+    for (int k = 0; k < SWEEP_PARAM_COUNT; k++) {
+        if (!parse_axis(args, std::string("--") + PARAM_NAMES[k], spec.axes[k])) return 2;
+    }
+    spec.sim_time = args.getDouble("--sim-time", spec.sim_time);
+    spec.dt = args.getDouble("--dt", spec.dt);
+    spec.iterations = static_cast<std::int32_t>(args.getInt("--iterations", spec.iterations));
+    spec.shard_size = static_cast<std::uint32_t>(args.getInt("--shard-size", spec.shard_size));
+    if (spec.dt <= 0.0 || spec.sim_time < 0.0 || spec.iterations < 1 || spec.shard_size < 1) {
+        std::cerr << "Bad sweep settings" << std::endl;
+        return 2;
+    }
+    if (spec.axes[SWEEP_MASS2].lo <= 0.0 || spec.axes[SWEEP_MASS2].hi <= 0.0 ||
+        spec.axes[SWEEP_LENGTH2].lo <= 0.0 || spec.axes[SWEEP_LENGTH2].hi <= 0.0) {
+        std::cerr << "Masses and lengths must be positive" << std::endl;
+        return 2;
+    }
+
+    SweepFile file;
+    if (!file.open(path, &spec)) return 2;
+    const SweepFileHeader& h = file.header();
+
+    std::vector<std::uint64_t> todo;
+    for (std::uint64_t s = 0; s < h.shard_count; s++) {
+        if (file.states()[s] != SHARD_DONE) todo.push_back(s);
+    }
+    long long workers = args.getInt("--workers", std::max(1u, std::thread::hardware_concurrency()));
+    workers = std::max(1LL, workers);
+    std::cout << "Sweep " << path << ": " << h.point_count << " points in " << h.shard_count << " shards, "
+              << h.shard_count - todo.size() << " already done, " << workers << " workers" << std::endl;
+
+    //сам себя запускаем рабочим процессом; /proc/self/exe не зависит от текущей папки
+    std::string exe = access("/proc/self/exe", X_OK) == 0 ? "/proc/self/exe" : self_path;
+    std::map<pid_t, std::uint64_t> running;
+    size_t next = 0;
+    size_t failed = 0;
+    size_t finished = h.shard_count - todo.size();
+    while (next < todo.size() || !running.empty()) {
+        while (next < todo.size() && static_cast<long long>(running.size()) < workers) {
+            pid_t pid = launch_worker(exe, path, todo[next]);
+            if (pid < 0) {
+                std::cerr << "Cannot start worker: " << std::strerror(errno) << std::endl;
+                break;
+            }
+            running[pid] = todo[next++];
+        }
+        if (running.empty()) {
+            failed += todo.size() - next;
+            break;
+        }
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        auto it = running.find(pid);
+        if (it == running.end()) continue;
+        std::uint64_t shard = it->second;
+        running.erase(it);
+        //отметку в файле ставит сам рабочий - упавший посреди шарда её не оставит
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && file.states()[shard] == SHARD_DONE) {
+            finished++;
+            std::cout << "shard " << shard << " done (" << finished << "/" << h.shard_count << ")" << std::endl;
+        } else {
+            failed++;
+            if (WIFSIGNALED(status)) {
+                std::cerr << "shard " << shard << " failed: signal " << WTERMSIG(status) << std::endl;
+            } else {
+                std::cerr << "shard " << shard << " failed: exit code " << WEXITSTATUS(status) << std::endl;
+            }
+        }
+    }
+
+    std::string csv = args.get("--csv");
+    if (!csv.empty()) {
+        if (write_csv(csv, file)) {
+            std::cout << "Wrote " << csv << std::endl;
+        } else {
+            std::cerr << "Cannot write " << csv << std::endl;
+        }
+    }
+    if (failed > 0) {
+        std::cerr << failed << " shards not finished; run the same command again to resume" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int sweep_worker_mode(const CliArgs& args) {
+    std::string path = args.get("--sweep-worker");
+    long long shard = args.getInt("--shard", -1);
+    SweepFile file;
+    if (!file.open(path, nullptr)) return 2;
+    const SweepFileHeader& h = file.header();
+    if (shard < 0 || static_cast<std::uint64_t>(shard) >= h.shard_count) {
+        std::cerr << "--shard must be in [0, " << h.shard_count << ")" << std::endl;
+        return 2;
+    }
+    std::uint64_t s = static_cast<std::uint64_t>(shard);
+    if (file.states()[s] == SHARD_DONE) return 0;
+
+    std::uint64_t first = s * h.spec.shard_size;
+    std::uint64_t end = std::min(h.point_count, first + h.spec.shard_size);
+    SweepRecord* rec = file.records();
+    try {
+        for (std::uint64_t i = first; i < end; i++) {
+            rec[i] = run_sweep_point(h.spec, i);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "shard " << s << ": " << e.what() << std::endl;
+        return 1;
+    }
+    file.commitShard(s, first, end - first);
+    return 0;
+}
+
+#else
+
+//процессы и mmap здесь - POSIX; на Windows перебор не собирается
+int sweep_mode(const CliArgs&, const char*) {
+    std::cerr << "--sweep needs a POSIX system" << std::endl;
+    return 2;
+}
+
+int sweep_worker_mode(const CliArgs&) {
+    std::cerr << "--sweep-worker needs a POSIX system" << std::endl;
+    return 2;
+}
+
+#endif
@@ -0,0 +1,208 @@
+#include "../include/task_scheduler.h"
+#include "../include/trace.h"
+#include <algorithm>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+    //к какому пулу и под каким номером относится текущий поток
+    thread_local const TaskScheduler* tls_scheduler = nullptr;
+    thread_local int tls_worker = -1;
+
+    void pin_current_thread(unsigned cpu) {
+        unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+        cpu %= hw;
+#if defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)cpu;
+#endif
+    }
+}
+
+TaskScheduler::TaskScheduler(unsigned thread_count, bool pin_threads) : pin(pin_threads) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    unsigned worker_count = thread_count - 1;
+
+    for (unsigned i = 0; i <= worker_count; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    //воркеры занимают ядра с 1-го, ядро 0 остаётся вызывающему (см. pinCallingThread)
+    workers.reserve(worker_count);
+    for (unsigned i = 0; i < worker_count; i++) {
+        workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lk(park_lock);
+        stopping.store(true);
+    }
+    park_cv.notify_all();
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+void TaskScheduler::pinCallingThread() {
+    pin_current_thread(0);
+}
+
+int TaskScheduler::currentWorker() const {
+    return tls_scheduler == this ? tls_worker : -1;
+}
+
+void TaskScheduler::submit(Task task) {
+    int self = currentWorker();
+    WorkQueue& q = *queues[self >= 0 ? self : workers.size()];
+    {
+        std::lock_guard<std::mutex> lk(q.lock);
+        q.tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1);
+    wakeOne();
+}
+
+void TaskScheduler::wakeOne() {
+    if (sleepers.load() > 0) {
+        std::lock_guard<std::mutex> lk(park_lock);
+        park_cv.notify_one();
+    }
+}
+
+bool TaskScheduler::popLocal(unsigned idx, Task& out) {
+    WorkQueue& q = *queues[idx];
+    std::lock_guard<std::mutex> lk(q.lock);
+    if (q.tasks.empty()) return false;
+    out = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    queued.fetch_sub(1);
+    return true;
+}
+
+bool TaskScheduler::steal(unsigned thief, Task& out) {
+    size_t count = queues.size();
+    //общую очередь проверяем первой, дальше обходим соседей по кругу
+    for (size_t k = 0; k < count; k++) {
+        size_t victim = (k == 0) ? count - 1 : (thief + k) % count;
+        if (victim == thief) continue;
+        WorkQueue& q = *queues[victim];
+        std::unique_lock<std::mutex> lk(q.lock, std::try_to_lock);
+        if (!lk.owns_lock() || q.tasks.empty()) continue;
+        out = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+bool TaskScheduler::runOne() {
+    if (queued.load() == 0) return false;
+    int self = currentWorker();
+    unsigned idx = self >= 0 ? static_cast<unsigned>(self) : static_cast<unsigned>(workers.size());
+
+    Task task;
+    if (popLocal(idx, task) || steal(idx, task)) {
+        task();
+        return true;
+    }
+    return false;
+}
+
+void TaskScheduler::workerLoop(unsigned idx) {
+    tls_scheduler = this;
+    tls_worker = static_cast<int>(idx);
+    if (pin) pin_current_thread(idx + 1);
+    Trace::setThreadName("worker " + std::to_string(idx + 1));
+
+    Task task;
+    while (!stopping.load()) {
+        if (popLocal(idx, task) || steal(idx, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        //крутимся, пока не кончится время ожидания, потом засыпаем
+        auto spin_until = std::chrono::steady_clock::now() +
+                          std::chrono::microseconds(spin_time_us.load());
+        bool found = false;
+        while (!stopping.load() && std::chrono::steady_clock::now() < spin_until) {
+            if (queued.load() > 0) { found = true; break; }
+            std::this_thread::yield();
+        }
+        if (found) continue;
+
+        std::unique_lock<std::mutex> lk(park_lock);
+        sleepers.fetch_add(1);
+        park_cv.wait(lk, [this] { return stopping.load() || queued.load() > 0; });
+        sleepers.fetch_sub(1);
+    }
+}
+
+void TaskScheduler::parallel_for(size_t begin, size_t end, size_t grain,
+                                 const std::function<void(size_t, size_t)>& fn) {
+    if (begin >= end) return;
+    size_t n = end - begin;
+    if (grain == 0) {
+        grain = std::max<size_t>(1, n / (concurrency() * 4));
+    }
+    if (workers.empty() || n <= grain) {
+        fn(begin, end);
+        return;
+    }
+
+    TaskGroup group(*this);
+    for (size_t b = begin + grain; b < end; b += grain) {
+        size_t e = std::min(b + grain, end);
+        group.run([&fn, b, e] { fn(b, e); });
+    }
+    fn(begin, begin + grain);
+    group.wait();
+}
+
+void TaskGroup::run(TaskScheduler::Task task) {
+    pending.fetch_add(1);
+    scheduler.submit([this, t = std::move(task)] {
+        try {
+            t();
+        } catch (...) {
+            std::lock_guard<std::mutex> lk(error_lock);
+            if (!error) error = std::current_exception();
+        }
+        pending.fetch_sub(1);
+    });
+}
+
+void TaskGroup::wait_noexcept() {
+    while (pending.load() > 0) {
+        if (!scheduler.runOne()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskGroup::wait() {
+    wait_noexcept();
+    std::exception_ptr e;
+    {
+        std::lock_guard<std::mutex> lk(error_lock);
+        std::swap(e, error);
+    }
+    if (e) std::rethrow_exception(e);
+}
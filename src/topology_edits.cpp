@@ -0,0 +1,215 @@
+#include "../include/topology_edits.h"
+#include "../include/physics_engine.h"
+#include <algorithm>
+#include <stdexcept>
+
+size_t TopologyEdits::addParticle(const Vec2d& position, double mass, const Vec2d& velocity, bool fixed) {
+    if (!fixed && mass <= 0.0) {
+        throw std::invalid_argument("Particle mass must be positive");
+    }
+    new_particles.push_back({position, mass, velocity, fixed});
+    return PENDING_BIT | (new_particles.size() - 1);
+}
+
+void TopologyEdits::removeParticle(size_t idx) {
+    removed_particles.push_back(idx);
+}
+
+void TopologyEdits::setMass(size_t idx, double mass) {
+    if (mass <= 0.0) {
+        throw std::invalid_argument("Particle mass must be positive");
+    }
+    particle_edits.push_back({idx, Field::Mass, mass, {}});
+}
+
+void TopologyEdits::setFixed(size_t idx, bool fixed) {
+    particle_edits.push_back({idx, Field::Fixed, fixed ? 1.0 : 0.0, {}});
+}
+
+void TopologyEdits::setVelocity(size_t idx, const Vec2d& velocity) {
+    particle_edits.push_back({idx, Field::Velocity, 0.0, velocity});
+}
+
+void TopologyEdits::addConstraint(size_t idx1, size_t idx2, double length, double stiffness, bool rope) {
+    if (idx1 == idx2) {
+        throw std::invalid_argument("Cannot create constraint between same particle");
+    }
+    if (length == 0.0) {
+        throw std::invalid_argument("Constraint length must be positive");
+    }
+    if (stiffness < 0.0 || stiffness > 1.0) {
+        throw std::invalid_argument("Stiffness must be between 0 and 1");
+    }
+    new_constraints.push_back({idx1, idx2, length, stiffness, rope});
+}
+
+void TopologyEdits::removeConstraint(size_t idx) {
+    removed_constraints.push_back(idx);
+}
+
+void TopologyEdits::retuneConstraint(size_t idx, double length, double stiffness) {
+    if (length <= 0.0) {
+        throw std::invalid_argument("Constraint length must be positive");
+    }
+    if (stiffness < 0.0 || stiffness > 1.0) {
+        throw std::invalid_argument("Stiffness must be between 0 and 1");
+    }
+    constraint_edits.push_back({idx, length, stiffness});
+}
+
+void TopologyEdits::clear() {
+    new_particles.clear();
+    removed_particles.clear();
+    particle_edits.clear();
+    new_constraints.clear();
+    removed_constraints.clear();
+    constraint_edits.clear();
+}
+
+//вся пачка за один проход сжатия: O(N + M + число правок), а не O(N + M) на каждую
+ReorderMap PhysicsEngine::applyEdits(const TopologyEdits& edits) {
+    size_t n = particles.size();
+    size_t added = edits.new_particles.size();
+    auto valid_particle = [n, added](size_t idx) {
+        return TopologyEdits::isPending(idx) ? (idx & ~TopologyEdits::PENDING_BIT) < added : idx < n;
+    };
+
+    //сначала проверяем всё, чтобы при ошибке движок остался нетронутым
+    for (size_t idx : edits.removed_particles) {
+        if (!valid_particle(idx)) throw std::out_of_range("Edit refers to a missing particle");
+    }
+    for (const auto& e : edits.particle_edits) {
+        if (!valid_particle(e.idx)) throw std::out_of_range("Edit refers to a missing particle");
+    }
+    for (const auto& c : edits.new_constraints) {
+        if (!valid_particle(c.idx1) || !valid_particle(c.idx2)) {
+            throw std::out_of_range("Edit refers to a missing particle");
+        }
+    }
+    for (size_t idx : edits.removed_constraints) {
+        if (idx >= constraints.size()) throw std::out_of_range("Edit refers to a missing constraint");
+    }
+    for (const auto& e : edits.constraint_edits) {
+        if (e.idx >= constraints.size()) throw std::out_of_range("Edit refers to a missing constraint");
+    }
+
+    //старые индексы -> новые; удалённые (в том числе добавленные в этой же пачке) - NO_PARTICLE
+    std::vector<unsigned char> removed(n + added, 0);
+    auto slot = [n](size_t idx) {
+        return TopologyEdits::isPending(idx) ? n + (idx & ~TopologyEdits::PENDING_BIT) : idx;
+    };
+    for (size_t idx : edits.removed_particles) {
+        removed[slot(idx)] = 1;
+    }
+    std::vector<size_t> final_of_slot(n + added, NO_PARTICLE);
+    size_t kept = 0;
+    for (size_t s = 0; s < n + added; s++) {
+        if (!removed[s]) final_of_slot[s] = kept++;
+    }
+
+    for (const auto& e : edits.constraint_edits) {
+        constraints[e.idx].target_length = e.length;
+        constraints[e.idx].stiffness = e.stiffness;
+    }
+    std::vector<unsigned char> dropped(constraints.size(), 0);
+    for (size_t idx : edits.removed_constraints) {
+        dropped[idx] = 1;
+    }
+
+    //сжатие на месте: порядок оставшихся частиц и связей не меняется
+    size_t kept_old = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (final_of_slot[i] == NO_PARTICLE) continue;
+        particles[kept_old++] = particles[i];
+    }
+    particles.erase(particles.begin() + kept_old, particles.end());
+    particles.reserve(kept);
+    for (size_t k = 0; k < added; k++) {
+        if (removed[n + k]) continue;
+        const auto& p = edits.new_particles[k];
+        particles.emplace_back(p.position, p.mass, p.velocity, p.fixed);
+    }
+
+    size_t kept_constraints = 0;
+    for (size_t k = 0; k < constraints.size(); k++) {
+        Constraint c = constraints[k];
+        c.particle1_idx = final_of_slot[c.particle1_idx];
+        c.particle2_idx = final_of_slot[c.particle2_idx];
+        if (dropped[k] || c.particle1_idx == NO_PARTICLE || c.particle2_idx == NO_PARTICLE) continue;
+        constraints[kept_constraints++] = c;
+    }
+    constraints.erase(constraints.begin() + kept_constraints, constraints.end());
+    size_t kept_angles = 0;
+    for (auto a : angle_constraints) {
+        a.a = final_of_slot[a.a];
+        a.center = final_of_slot[a.center];
+        a.b = final_of_slot[a.b];
+        if (a.a == NO_PARTICLE || a.center == NO_PARTICLE || a.b == NO_PARTICLE) continue;
+        angle_constraints[kept_angles++] = a;
+    }
+    angle_constraints.erase(angle_constraints.begin() + kept_angles, angle_constraints.end());
+
+    //правки частиц - по порядку очереди, уже по новым индексам
+    for (const auto& e : edits.particle_edits) {
+        size_t idx = final_of_slot[slot(e.idx)];
+        if (idx == NO_PARTICLE) continue;
+        Particle& p = particles[idx];
+        switch (e.field) {
+        case TopologyEdits::Field::Mass:
+            p.setMass(e.value);
+            break;
+        case TopologyEdits::Field::Fixed:
+            p.fixed = e.value != 0.0;
+            p.inv_mass = p.fixed ? 0.0 : (p.inv_mass > 0.0 ? p.inv_mass : 1.0);
+            break;
+        case TopologyEdits::Field::Velocity:
+            p.velocity = e.velocity;
+            break;
+        }
+    }
+
+    reserveExtra(constraints, edits.new_constraints.size());
+    for (const auto& c : edits.new_constraints) {
+        size_t i1 = final_of_slot[slot(c.idx1)];
+        size_t i2 = final_of_slot[slot(c.idx2)];
+        if (i1 == NO_PARTICLE || i2 == NO_PARTICLE || i1 == i2) continue;
+        double length = c.length > 0.0 ? c.length
+                                       : leight(particles[i1].position - particles[i2].position);
+        //совпадающие частицы связать нельзя - пропускаем, как и связь с удалённой
+        if (length <= 0.0) continue;
+        constraints.emplace_back(i1, i2, length, c.stiffness,
+                                 c.rope ? ConstraintKind::Rope : ConstraintKind::Distance);
+    }
+
+    ReorderMap map;
+    map.new_of_old.assign(final_of_slot.begin(), final_of_slot.begin() + n);
+    map.old_of_new.assign(particles.size(), NO_PARTICLE);
+    for (size_t i = 0; i < n; i++) {
+        if (map.new_of_old[i] != NO_PARTICLE) map.old_of_new[map.new_of_old[i]] = i;
+    }
+
+    if (kept_old != n) {
+        for (const auto& field : force_fields) {
+            field->remapParticles(map.new_of_old, particles.size());
+        }
+    }
+    topology_version++;
+    weights_dirty = true;
+    if (reorder_listener) reorder_listener(map);
+    return map;
+}
+
+bool PhysicsEngine::commitEdits() {
+    if (pending_edits.empty()) return false;
+    //очередь очищается и при ошибке: иначе одна плохая правка блокировала бы все шаги
+    TopologyEdits batch;
+    std::swap(batch, pending_edits);
+    try {
+        applyEdits(batch);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Failed to apply edits: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
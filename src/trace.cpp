@@ -0,0 +1,154 @@
+#include "../include/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    struct Event {
+        const char* name;
+        std::uint64_t start_ns;
+        std::uint64_t dur_ns;
+    };
+
+    //ячейка кольца; поля атомарные, потому что выгрузка читает их, пока владелец
+    //может писать в ту же ячейку (relaxed - обычные mov)
+    struct EventSlot {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<std::uint64_t> start_ns{0};
+        std::atomic<std::uint64_t> dur_ns{0};
+    };
+
+    //кольцо событий одного потока: пишет только владелец, читатель видит
+    //всё до write_pos; при переполнении затираются самые старые события
+    struct ThreadBuffer {
+        static constexpr size_t CAPACITY = size_t(1) << 16;
+
+        std::vector<EventSlot> events = std::vector<EventSlot>(CAPACITY);
+        std::atomic<std::uint64_t> write_pos{0};
+        std::atomic<std::uint64_t> cleared_pos{0};
+        unsigned tid = 0;
+        std::string name;
+    };
+
+    std::atomic<bool> trace_enabled{false};
+
+    //реестр нужен только при первой записи потока и при выгрузке
+    std::mutex registry_lock;
+    std::vector<std::shared_ptr<ThreadBuffer>> registry;
+
+    //кольцо (CAPACITY ячеек) заводится при первой записи потока, так что потоки,
+    //которые только назвались, при выключенной трассе памяти не занимают
+    thread_local std::shared_ptr<ThreadBuffer> local;
+    thread_local std::string local_name;
+
+    ThreadBuffer& local_buffer() {
+        if (!local) {
+            local = std::make_shared<ThreadBuffer>();
+            std::lock_guard<std::mutex> lk(registry_lock);
+            local->tid = static_cast<unsigned>(registry.size() + 1);
+            local->name = local_name;
+            registry.push_back(local);
+        }
+        return *local;
+    }
+
+    void write_escaped(std::FILE* f, const std::string& s) {
+        for (char c : s) {
+            if (c == '"' || c == '\\') std::fputc('\\', f);
+            std::fputc(c, f);
+        }
+    }
+}
+
+namespace Trace {
+    void setEnabled(bool on) { trace_enabled.store(on, std::memory_order_relaxed); }
+    bool enabled() { return trace_enabled.load(std::memory_order_relaxed); }
+
+    void setThreadName(const std::string& name) {
+        local_name = name;
+        if (!local) return;
+        std::lock_guard<std::mutex> lk(registry_lock);
+        local->name = name;
+    }
+
+    void record(const char* name, std::uint64_t start_ns, std::uint64_t end_ns) {
+        ThreadBuffer& b = local_buffer();
+        std::uint64_t pos = b.write_pos.load(std::memory_order_relaxed);
+        //запись ячейки не должна обогнать прошлую публикацию write_pos:
+        //по ней выгрузка понимает, какие ячейки могли быть затёрты
+        std::atomic_thread_fence(std::memory_order_release);
+        EventSlot& slot = b.events[pos % ThreadBuffer::CAPACITY];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start_ns.store(start_ns, std::memory_order_relaxed);
+        slot.dur_ns.store(end_ns - start_ns, std::memory_order_relaxed);
+        b.write_pos.store(pos + 1, std::memory_order_release);
+    }
+
+    size_t eventCount() {
+        std::lock_guard<std::mutex> lk(registry_lock);
+        size_t total = 0;
+        for (const auto& b : registry) {
+            std::uint64_t end = b->write_pos.load(std::memory_order_acquire);
+            std::uint64_t begin = b->cleared_pos.load(std::memory_order_relaxed);
+            total += static_cast<size_t>(std::min<std::uint64_t>(end - begin, ThreadBuffer::CAPACITY));
+        }
+        return total;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lk(registry_lock);
+        for (const auto& b : registry) {
+            b->cleared_pos.store(b->write_pos.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+    }
+
+    bool writeJson(const std::string& path) {
+        std::FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) return false;
+
+        std::lock_guard<std::mutex> lk(registry_lock);
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+        bool first = true;
+        std::vector<Event> copied;
+        for (const auto& b : registry) {
+            if (!b->name.empty()) {
+                std::fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+                             first ? "" : ",\n", b->tid);
+                write_escaped(f, b->name);
+                std::fputs("\"}}", f);
+                first = false;
+            }
+
+            //потоки продолжают писать: сначала копируем, потом по новому write_pos
+            //отбрасываем ячейки, которые за время копирования могли быть затёрты
+            //(включая ту, что пишется прямо сейчас)
+            std::uint64_t end = b->write_pos.load(std::memory_order_acquire);
+            std::uint64_t begin = std::max(b->cleared_pos.load(std::memory_order_relaxed),
+                                           end > ThreadBuffer::CAPACITY ? end - ThreadBuffer::CAPACITY : 0);
+            copied.clear();
+            for (std::uint64_t i = begin; i < end; i++) {
+                const EventSlot& slot = b->events[i % ThreadBuffer::CAPACITY];
+                copied.push_back({slot.name.load(std::memory_order_relaxed),
+                                  slot.start_ns.load(std::memory_order_relaxed),
+                                  slot.dur_ns.load(std::memory_order_relaxed)});
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            std::uint64_t after = b->write_pos.load(std::memory_order_relaxed);
+            std::uint64_t safe = after >= ThreadBuffer::CAPACITY ? after - ThreadBuffer::CAPACITY + 1 : 0;
+            size_t skip = safe > begin ? static_cast<size_t>(std::min(safe, end) - begin) : 0;
+
+            for (size_t k = skip; k < copied.size(); k++) {
+                const Event& e = copied[k];
+                std::fprintf(f, "%s{\"ph\":\"X\",\"cat\":\"pendulum\",\"name\":\"%s\",\"pid\":1,\"tid\":%u,"
+                                "\"ts\":%.3f,\"dur\":%.3f}",
+                             first ? "" : ",\n", e.name, b->tid, e.start_ns / 1000.0, e.dur_ns / 1000.0);
+                first = false;
+            }
+        }
+        std::fputs("\n]}\n", f);
+        return std::fclose(f) == 0;
+    }
+}
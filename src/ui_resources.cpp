@@ -0,0 +1,143 @@
+#include "../include/ui_resources.h"
+#include "../include/trace.h"
+#include "../include/visual_config.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+    //системные шрифты по платформам: первый найденный и берём
+    const char* const SYSTEM_FONTS[] = {
+#if defined(_WIN32)
+        "C:/Windows/Fonts/calibri.ttf",
+        "C:/Windows/Fonts/segoeui.ttf",
+        "C:/Windows/Fonts/arial.ttf",
+#elif defined(__APPLE__)
+        "/System/Library/Fonts/Supplemental/Arial.ttf",
+        "/Library/Fonts/Arial.ttf",
+        "/System/Library/Fonts/Helvetica.ttc",
+#else
+        "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+        "/usr/share/fonts/dejavu/DejaVuSans.ttf",
+        "/usr/share/fonts/TTF/DejaVuSans.ttf",
+        "/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+        "/usr/share/fonts/liberation-sans/LiberationSans-Regular.ttf",
+        "/usr/share/fonts/truetype/noto/NotoSans-Regular.ttf",
+        "/usr/share/fonts/noto/NotoSans-Regular.ttf",
+#endif
+    };
+
+    //папка раскрывается в свои .ttf/.otf по алфавиту
+    std::vector<std::string> expand(const std::string& path) {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        if (!fs::is_directory(path, ec)) return {path};
+        std::vector<std::string> files;
+        for (const auto& entry : fs::directory_iterator(path, ec)) {
+            std::string ext = entry.path().extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+            if (ext == ".ttf" || ext == ".otf") files.push_back(entry.path().string());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    bool read_file(const std::string& path, std::vector<char>& data) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return !data.empty();
+    }
+}
+
+UiResources::UiResources() {
+    if (const char* env = std::getenv("PENDULUM_FONT")) {
+        if (*env) paths.push_back(env);
+    }
+    paths.insert(paths.end(), std::begin(SYSTEM_FONTS), std::end(SYSTEM_FONTS));
+}
+
+UiResources::~UiResources() {
+    if (worker.joinable()) worker.join();
+}
+
+void UiResources::addFontPath(const std::string& path) {
+    if (started) {
+        std::cerr << "Font path " << path << " added after loading started, ignored" << std::endl;
+        return;
+    }
+    //за добавленными раньше, но перед стандартными
+    paths.insert(paths.begin() + user_paths++, path);
+}
+
+void UiResources::startLoading() {
+    if (started) return;
+    started = true;
+    worker = std::thread([this] {
+        Trace::setThreadName("ui loader");
+        load();
+        worker_done.store(true, std::memory_order_release);
+    });
+}
+
+//фоновый поток: чтение файла и разбор шрифта, без текстур (им нужен контекст окна)
+void UiResources::load() {
+    PENDULUM_TRACE_ZONE("UiResources::load");
+    for (const std::string& path : paths) {
+        for (const std::string& file : expand(path)) {
+            if (!read_file(file, font_data)) continue;
+            if (ui_font.openFromMemory(font_data.data(), font_data.size())) {
+                font_file = file;
+                font_ok = true;
+                return;
+            }
+        }
+    }
+    font_data.clear();
+}
+
+void UiResources::handOver() {
+    if (worker.joinable()) worker.join();
+    handed_over = true;
+    if (font_ok) {
+        ui_font.setSmooth(true);
+        return;
+    }
+    std::cerr << "No UI font found, dialog text will not be drawn. Tried:";
+    for (const std::string& path : paths) {
+        std::cerr << " " << path;
+    }
+    std::cerr << " (set PENDULUM_FONT or pass --font <file>)" << std::endl;
+}
+
+void UiResources::poll() {
+    if (!handed_over) {
+        if (!started || !worker_done.load(std::memory_order_acquire)) return;
+        handOver();
+    }
+    //глифы печатных ASCII одного размера за кадр: первое открытие диалога их уже не ждёт
+    constexpr size_t SIZE_COUNT = std::size(Config::PREBAKED_FONT_SIZES);
+    if (!font_ok || baked_sizes >= SIZE_COUNT) return;
+    PENDULUM_TRACE_ZONE("UiResources::bake");
+    unsigned size = Config::PREBAKED_FONT_SIZES[baked_sizes++];
+    for (char32_t c = U' '; c <= U'~'; c++) {
+        ui_font.getGlyph(c, size, false);
+    }
+}
+
+void UiResources::waitLoaded() {
+    if (handed_over) return;
+    startLoading();
+    handOver();
+}
+
+std::unique_ptr<sf::Text> UiResources::makeText(const std::string& str, unsigned size, sf::Color color) {
+    waitLoaded();
+    auto text = std::make_unique<sf::Text>(ui_font, str, size);
+    text->setFillColor(color);
+    return text;
+}
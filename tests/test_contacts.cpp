@@ -0,0 +1,62 @@
+//контакты с неподвижной геометрией: частицу, которую связи затянули в стенку
+//во время итераций, всё равно выталкивает, а частицы с inv_mass = 0 не двигаются
+#include "../include/physics_engine.h"
+#include <cstdio>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+//связь длины 1 тянет частицу с x = 1.5 к x = 1 сквозь стенку x = 1.2;
+//в начале шага стенки рядом нет, контакт появляется только после прохода связей
+static void constraint_pulls_into_wall() {
+    for (SolverMode mode : {SolverMode::GaussSeidel, SolverMode::Jacobi, SolverMode::ConjugateGradient}) {
+        PhysicsEngine engine(Vec2d(0.0, 0.0), 0.016, 8);
+        engine.setSolverMode(mode);
+        engine.setCollisionRadius(0.05);
+        engine.getColliders().addSegment(Vec2d{1.2, -1.0}, Vec2d{1.2, 1.0});
+
+        Vec2d positions[2] = {{0.0, 0.0}, {1.5, 0.0}};
+        double masses[2] = {1.0, 1.0};
+        std::uint8_t fixed[2] = {1, 0};
+        engine.addParticles(positions, 2, masses, fixed);
+        size_t pair[2] = {0, 1};
+        double length = 1.0;
+        engine.addConstraints(pair, 1, &length);
+
+        for (int i = 0; i < 5; i++) {
+            engine.step();
+            CHECK(engine.getParticle(1).position.x >= 1.2 + 0.05 - 1e-9);
+        }
+    }
+}
+
+//незакреплённая частица с нулевой массой (inv_mass = 0) внутри круга остаётся на месте
+static void zero_inverse_mass_not_pushed() {
+    PhysicsEngine engine(Vec2d(0.0, 0.0), 0.016, 4);
+    engine.setCollisionRadius(0.1);
+    engine.getColliders().addCircle(Vec2d{0.0, 0.0}, 1.0);
+
+    Vec2d positions[2] = {{0.5, 0.0}, {0.0, 0.5}};
+    double masses[2] = {0.0, 1.0};
+    engine.addParticles(positions, 2, masses);
+    CHECK(engine.getParticle(0).inv_mass == 0.0 && !engine.getParticle(0).fixed);
+
+    engine.step();
+    CHECK(engine.getParticle(0).position.x == 0.5 && engine.getParticle(0).position.y == 0.0);
+    //обычную частицу выталкивает на поверхность
+    CHECK(engine.getParticle(1).position.y >= 1.1 - 1e-9);
+}
+
+int main() {
+    constraint_pulls_into_wall();
+    zero_inverse_mass_not_pushed();
+    if (failures == 0) std::printf("ok\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+//удаление частиц при подключённых полях сил: данные полей должны
+//переехать на новые индексы, а данные удалённых частиц - пропасть
+#include "../include/physics_engine.h"
+#include <cstdio>
+#include <memory>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+//удаление одной частицы напрямую
+static void remove_charged_particle() {
+    PhysicsEngine engine(Vec2d(0, 300.0), 0.016, 10);
+    engine.createChain(Vec2d{0.0, 0.0}, 5, 10.0, 1.0, Vec2d{1.0, 0.0});
+    auto field = std::make_shared<PairwiseField>(PairwiseField::Kind::Electrostatic, 100.0);
+    field->setCharges({10.0, 11.0, 12.0, 13.0, 14.0, 15.0});
+    engine.addForceField(field);
+    auto springs = std::make_shared<SpringField>();
+    springs->addAnchor(2, Vec2d{0.0, 0.0}, 1.0);
+    springs->addSpring(1, 2, 1.0, 10.0);
+    springs->addSpring(3, 4, 1.0, 10.0);
+    engine.addForceField(springs);
+
+    engine.removeParticle(2);
+    const std::vector<double>& q = field->getCharges();
+    CHECK(engine.getParticleCount() == 5);
+    CHECK(q.size() == 5);
+    if (q.size() == 5) {
+        CHECK(q[0] == 10.0 && q[1] == 11.0 && q[2] == 13.0 && q[3] == 14.0 && q[4] == 15.0);
+    }
+    for (int i = 0; i < 10; i++) {
+        engine.step();
+    }
+    CHECK(engine.getParticleCount() == 5);
+}
+
+//пачка правок: удаление и добавление сразу
+static void remove_and_add_in_one_batch() {
+    PhysicsEngine engine(Vec2d(0, 300.0), 0.016, 10);
+    engine.createChain(Vec2d{0.0, 0.0}, 3, 10.0, 1.0, Vec2d{1.0, 0.0});
+    auto field = std::make_shared<PairwiseField>(PairwiseField::Kind::Electrostatic, 100.0);
+    field->setCharges({1.0, 2.0, 3.0, 4.0});
+    engine.addForceField(field);
+
+    engine.edits().removeParticle(1);
+    engine.edits().removeParticle(3);
+    engine.edits().addParticle(Vec2d{50.0, 0.0}, 1.0);
+    CHECK(engine.commitEdits());
+    const std::vector<double>& q = field->getCharges();
+    CHECK(engine.getParticleCount() == 3);
+    CHECK(q.size() == 3);
+    if (q.size() == 3) {
+        CHECK(q[0] == 1.0 && q[1] == 3.0 && q[2] == 1.0);
+    }
+    engine.step();
+}
+
+int main() {
+    remove_charged_particle();
+    remove_and_add_in_one_batch();
+    if (failures == 0) std::printf("ok\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+//перенумерация частиц для локальности не должна менять результат Гаусса-Зейделя:
+//цепочка из 100 звеньев, dt 0.016, 10 итераций, 300 шагов
+#include "../include/physics_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+static double max_stretch(const PhysicsEngine& engine) {
+    double worst = 0.0;
+    for (size_t k = 0; k < engine.getConstraintCount(); k++) {
+        const Constraint& c = engine.getConstraint(k);
+        Vec2d d = engine.getParticle(c.particle2_idx).position - engine.getParticle(c.particle1_idx).position;
+        worst = std::max(worst, std::abs(leight(d) - c.target_length) / c.target_length);
+    }
+    return worst;
+}
+
+//состояние по исходным номерам частиц
+static std::vector<Vec2d> run_chain(ReorderMethod method, double& stretch) {
+    PhysicsEngine engine(Vec2d(0, 300.0), 0.016, 10);
+    engine.createChain(Vec2d{0.0, 0.0}, 100, 10.0, 1.0, Vec2d{1.0, 0.0});
+    std::vector<size_t> new_of_old(engine.getParticleCount());
+    for (size_t i = 0; i < new_of_old.size(); i++) {
+        new_of_old[i] = i;
+    }
+    engine.setReorderListener([&new_of_old](const ReorderMap& map) {
+        for (size_t& idx : new_of_old) {
+            idx = map.new_of_old[idx];
+        }
+    });
+    engine.reorderForLocality(method);
+    for (int i = 0; i < 300; i++) {
+        engine.step();
+    }
+    stretch = max_stretch(engine);
+    std::vector<Vec2d> out;
+    for (size_t idx : new_of_old) {
+        out.push_back(engine.getParticle(idx).position);
+    }
+    return out;
+}
+
+static void reorder_keeps_gauss_seidel_result(ReorderMethod method) {
+    double plain_stretch = 0.0, reordered_stretch = 0.0;
+    std::vector<Vec2d> plain = run_chain(ReorderMethod::None, plain_stretch);
+    std::vector<Vec2d> reordered = run_chain(method, reordered_stretch);
+    CHECK(plain_stretch == reordered_stretch);
+    CHECK(plain.size() == reordered.size());
+    bool same = plain.size() == reordered.size();
+    for (size_t i = 0; same && i < plain.size(); i++) {
+        same = plain[i].x == reordered[i].x && plain[i].y == reordered[i].y;
+    }
+    CHECK(same);
+}
+
+int main() {
+    reorder_keeps_gauss_seidel_result(ReorderMethod::ReverseCuthillMcKee);
+    reorder_keeps_gauss_seidel_result(ReorderMethod::BFS);
+    if (failures == 0) std::printf("ok\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+//перемотка по снимкам: досчитанное состояние должно побитово совпасть с исходным,
+//в том числе через смену dt/итераций регулятором качества; через смену остальных
+//параметров шага перематывать нельзя
+#include "../include/physics_engine.h"
+#include "../include/quality_controller.h"
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+//назад и вперёд; у CG снимок несёт множители тёплого старта
+static void seek_matches_history(SolverMode mode) {
+    PhysicsEngine engine(Vec2d(0, 300.0), 0.016, 10);
+    engine.setSolverMode(mode);
+    //CG сходится за отведённые шаги - множители переходят в следующий шаг
+    engine.setCGParameters(100, 1e-2);
+    engine.createChain(Vec2d{0.0, 0.0}, 20, 10.0, 1.0, Vec2d{1.0, 0.0});
+    engine.enableSnapshots(1 << 20, 5);
+
+    std::vector<std::uint64_t> hashes;
+    for (int i = 0; i < 60; i++) {
+        hashes.push_back(engine.stateHash());
+        engine.step();
+    }
+    CHECK(engine.seekStep(37));
+    CHECK(engine.getStepCount() == 37);
+    CHECK(engine.stateHash() == hashes[37]);
+    CHECK(engine.seekRelative(-30));
+    CHECK(engine.stateHash() == hashes[7]);
+    CHECK(engine.seekStep(59));
+    CHECK(engine.stateHash() == hashes[59]);
+}
+
+//снимки, посчитанные с другим затуханием или гравитацией, для перемотки не годятся
+static void seek_refused_after_params_change() {
+    PhysicsEngine engine(Vec2d(0, 300.0), 0.016, 10);
+    engine.createChain(Vec2d{0.0, 0.0}, 5, 10.0, 1.0, Vec2d{1.0, 0.0});
+    engine.enableSnapshots(1 << 20, 5);
+    for (int i = 0; i < 20; i++) {
+        engine.step();
+    }
+    engine.setDamping(0.01);
+    CHECK(!engine.seekStep(10));
+    engine.setGravity(Vec2d(0, 200.0));
+    CHECK(!engine.seekStep(0));
+    engine.step();
+    CHECK(engine.seekStep(20));
+}
+
+//то же для настроек решателей, столкновений и полей сил, включая правку поля снаружи
+static void seek_refused_after_solver_and_field_changes() {
+    PhysicsEngine engine(Vec2d(0, 300.0), 0.016, 10);
+    engine.createChain(Vec2d{0.0, 0.0}, 5, 10.0, 1.0, Vec2d{1.0, 0.0});
+    engine.enableSnapshots(1 << 20, 1);
+    auto attractor = std::make_shared<PointAttractor>(Vec2d{0.0, 100.0}, 1000.0);
+
+    std::vector<std::function<void()>> changes = {
+        [&] { engine.setJacobiRelaxation(1.2); },
+        [&] { engine.setCGParameters(7, 1e-3); },
+        [&] { engine.setCollisionRadius(3.0); },
+        [&] { engine.getColliders().addCircle(Vec2d{0.0, 500.0}, 20.0); },
+        [&] { engine.addForceField(attractor); },
+        [&] { attractor->setStrength(2000.0); },
+        [&] { engine.removeForceField(attractor); },
+    };
+    for (auto& change : changes) {
+        for (int i = 0; i < 5; i++) {
+            engine.step();
+        }
+        std::uint64_t now = engine.getStepCount();
+        CHECK(engine.seekStep(now - 2));
+        CHECK(engine.seekStep(now));
+        change();
+        CHECK(!engine.seekStep(now - 2));
+    }
+}
+
+//досчёт при перемотке не применяет отложенные правки и не пишет хэши и диагностику повторно
+static void seek_replay_has_no_side_effects() {
+    PhysicsEngine engine(Vec2d(0, 300.0), 0.016, 10);
+    engine.createChain(Vec2d{0.0, 0.0}, 5, 10.0, 1.0, Vec2d{1.0, 0.0});
+    engine.enableSnapshots(1 << 20, 10);
+    engine.setHashInterval(1);
+    engine.enableDiagnostics(100, 1);
+    for (int i = 0; i < 30; i++) {
+        engine.step();
+    }
+    size_t hashes = engine.getHashTrace().size();
+    size_t samples = engine.getDiagnostics().size();
+    CHECK(engine.seekStep(25));
+    CHECK(engine.getHashTrace().size() == hashes);
+    CHECK(engine.getDiagnostics().size() == samples);
+
+    size_t version = engine.getTopologyVersion();
+    engine.edits().removeParticle(3);
+    CHECK(!engine.seekStep(15));
+    CHECK(engine.getStepCount() == 25);
+    CHECK(engine.getTopologyVersion() == version);
+}
+
+//регулятор качества меняет dt и итерации: история остаётся, назад досчитывается
+//с теми параметрами, с которыми шла, а после перемотки движок снова на текущей ступени
+static void seek_across_quality_levels() {
+    PhysicsEngine engine(Vec2d(0, 300.0), 0.016, 10);
+    engine.createChain(Vec2d{0.0, 0.0}, 20, 10.0, 1.0, Vec2d{1.0, 0.0});
+    engine.enableSnapshots(1 << 20, 5);
+    QualityController quality(engine, 0.016);
+    quality.setAdaptive(false);
+
+    std::map<std::uint64_t, std::uint64_t> hashes;
+    auto run = [&](size_t level, int frames) {
+        quality.setLevel(level);
+        for (int f = 0; f < frames; f++) {
+            quality.advance();
+            hashes[engine.getStepCount()] = engine.stateHash();
+        }
+    };
+    run(3, 13);
+    run(5, 9);
+    run(2, 7);
+    const QualityLevel& last = quality.currentLevel();
+
+    std::uint64_t newest = engine.getStepCount();
+    for (auto it = hashes.rbegin(); it != hashes.rend(); ++it) {
+        CHECK(engine.seekStep(it->first));
+        CHECK(engine.stateHash() == it->second);
+    }
+    CHECK(engine.seekStep(newest));
+    CHECK(engine.stateHash() == hashes[newest]);
+    CHECK(engine.getTimeStep() == 0.016 / last.substeps);
+    CHECK(engine.getSolverIterations() == last.iterations);
+
+    //после перемотки назад новая ступень переписывает будущее, прошлое остаётся
+    CHECK(engine.seekStep(10));
+    std::uint64_t before = hashes[7];
+    run(4, 5);
+    std::uint64_t branch_step = engine.getStepCount();
+    std::uint64_t branch = engine.stateHash();
+    CHECK(engine.seekStep(7));
+    CHECK(engine.stateHash() == before);
+    CHECK(engine.seekStep(branch_step));
+    CHECK(engine.stateHash() == branch);
+}
+
+//ёмкость кольца - по бюджету памяти
+static void ring_fits_budget() {
+    PhysicsEngine engine(Vec2d(0, 300.0), 0.016, 10);
+    engine.createChain(Vec2d{0.0, 0.0}, 99, 10.0, 1.0, Vec2d{1.0, 0.0});
+    engine.enableSnapshots(100 * 2 * sizeof(Vec2d) * 10, 1);
+    for (int i = 0; i < 50; i++) {
+        engine.step();
+    }
+    const SnapshotRing& ring = engine.getSnapshots();
+    CHECK(ring.capacity() > 0 && ring.capacity() <= 10);
+    CHECK(ring.size() == ring.capacity());
+    CHECK(ring.newestStep() == 49);
+}
+
+int main() {
+    seek_matches_history(SolverMode::GaussSeidel);
+    seek_matches_history(SolverMode::ConjugateGradient);
+    seek_refused_after_params_change();
+    seek_refused_after_solver_and_field_changes();
+    seek_replay_has_no_side_effects();
+    seek_across_quality_levels();
+    ring_fits_budget();
+    if (failures == 0) std::printf("ok\n");
+    return failures == 0 ? 0 : 1;
+}